@@ -0,0 +1,119 @@
+#include <bench.h>
+#include <atomic_stack.h>
+#include <stack.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Every thread runs push, pop pairs on one shared stack, compared for the
+// mutex guarded stack_t and atomic_stack_t with and without elimination.
+// Usage: atomic_stack_bench [max threads] [pairs per thread]
+
+#define PREFILL 1024
+
+typedef enum {LOCKED, LOCK_FREE, ELIMINATION} variant_t;
+
+typedef struct bench_run
+{
+    variant_t variant;
+    stack_t * stack;
+    pthread_mutex_t lock;
+    atomic_stack_t * atomic_stack;
+    size_t pairs;
+    pthread_barrier_t start;
+} bench_run_t;
+
+static void * run_thread(void * arg);
+static double run_variant(variant_t variant, size_t threads, size_t pairs);
+
+int main(int argc, char ** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = bench_arg(argc, argv, 1, (cpus > 0) ? (size_t)cpus : 1);
+    size_t pairs = bench_arg(argc, argv, 2, 1000000);
+
+    printf("%8s %14s %14s %14s\n", "threads", "locked Mops", "lockfree Mops", "elim Mops");
+    for (size_t threads = 1; threads <= max_threads; threads++)
+    {
+        printf("%8zu %14.2f %14.2f %14.2f\n", threads,
+               run_variant(LOCKED, threads, pairs),
+               run_variant(LOCK_FREE, threads, pairs),
+               run_variant(ELIMINATION, threads, pairs));
+    }
+
+    return 0;
+}
+
+static double run_variant(variant_t variant, size_t threads, size_t pairs)
+{
+    bench_run_t run = {.variant = variant, .pairs = pairs};
+    pthread_mutex_init(&(run.lock), NULL);
+    pthread_barrier_init(&(run.start), NULL, (unsigned)threads + 1);
+
+    // Keep some elements underneath so pops never see an empty stack
+    if (LOCKED == variant)
+    {
+        run.stack = stack_create(NULL, NULL);
+        for (size_t i = 0; i < PREFILL; i++)
+        {
+            stack_push(run.stack, &run);
+        }
+    }
+    else
+    {
+        run.atomic_stack = atomic_stack_create(PREFILL + threads, NULL, ELIMINATION == variant);
+        for (size_t i = 0; i < PREFILL; i++)
+        {
+            atomic_stack_push(run.atomic_stack, &run);
+        }
+    }
+
+    pthread_t * workers = calloc(threads, sizeof(*workers));
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_create(&(workers[i]), NULL, run_thread, &run);
+    }
+
+    pthread_barrier_wait(&(run.start));
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    uint64_t elapsed = bench_now() - begin;
+
+    free(workers);
+    stack_destroy(run.stack);
+    atomic_stack_destroy(run.atomic_stack);
+    pthread_barrier_destroy(&(run.start));
+    pthread_mutex_destroy(&(run.lock));
+    return bench_mops(threads * pairs * 2, elapsed);
+}
+
+static void * run_thread(void * arg)
+{
+    bench_run_t * run = arg;
+    pthread_barrier_wait(&(run->start));
+
+    for (size_t i = 0; i < run->pairs; i++)
+    {
+        if (LOCKED == run->variant)
+        {
+            pthread_mutex_lock(&(run->lock));
+            stack_push(run->stack, run);
+            pthread_mutex_unlock(&(run->lock));
+
+            pthread_mutex_lock(&(run->lock));
+            stack_pop(run->stack);
+            pthread_mutex_unlock(&(run->lock));
+        }
+        else
+        {
+            atomic_stack_push(run->atomic_stack, run);
+            atomic_stack_pop(run->atomic_stack);
+        }
+    }
+
+    return NULL;
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Shared helpers for the programs in bench/, built with -DDSTRUCT_BENCH=ON
+
+static inline uint64_t bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+// Millions of operations per second over elapsed nanoseconds
+static inline double bench_mops(size_t operations, uint64_t elapsed)
+{
+    return (elapsed > 0) ? ((double)operations * 1000.0) / (double)elapsed : 0.0;
+}
+
+// Seeded xorshift so every run replays the same keys
+static inline uint64_t bench_random(uint64_t * state)
+{
+    uint64_t value = *state;
+    value ^= value << 13;
+    value ^= value >> 7;
+    value ^= value << 17;
+    *state = value;
+    return value;
+}
+
+// Positional argument as a count, or fallback when it is missing
+static inline size_t bench_arg(int argc, char ** argv, int index, size_t fallback)
+{
+    return (index < argc) ? (size_t)strtoull(argv[index], NULL, 10) : fallback;
+}
+
+#endif
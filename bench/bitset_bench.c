@@ -0,0 +1,330 @@
+#include <bench.h>
+#include <bitset.h>
+#include <set.h>
+#include <stdio.h>
+#include <string.h>
+
+// Times union, intersect and difference with each bitset path forced in turn,
+// against the same elements held in sorted and hashed set_t. Every path's
+// result is checked bit for bit against the scalar one and against set_t.
+// Usage: bitset_bench [--check] [max power of two bits, default 20]
+// With --check only the comparisons run, over sizes that leave partial words.
+
+#define DENSITY_PERCENT 25
+#define BITS_PER_SIZE ((size_t)1 << 26)
+
+typedef enum {OP_UNION, OP_INTERSECT, OP_DIFFERENCE, OP_COUNT} op_t;
+
+static const char * op_names[] = {"union", "intersect", "difference"};
+static const bitset_path_t paths[] = {BITSET_PATH_SCALAR, BITSET_PATH_SSE2, BITSET_PATH_AVX2};
+static const size_t check_sizes[] = {1, 63, 64, 65, 255, 257, 1000, 4099, 65536};
+
+typedef struct operands
+{
+    size_t bits;
+    size_t * values;
+    bitset_t * first;
+    bitset_t * second;
+    set_t * sorted_first;
+    set_t * sorted_second;
+    set_t * hashed_first;
+    set_t * hashed_second;
+} operands_t;
+
+static int compare_values(const void * arg1, const void * arg2);
+static size_t hash_value(const void * arg);
+static int load_operands(operands_t * operands, size_t bits, uint64_t * state);
+static void free_operands(operands_t * operands);
+static int apply_bitset(bitset_t * bitset, bitset_t * other, op_t op);
+static set_t * apply_set(set_t * set1, set_t * set2, op_t op);
+static bitset_t * result_for(operands_t * operands, bitset_path_t path, op_t op, size_t repeats, uint64_t * elapsed);
+static double time_set(set_t * set1, set_t * set2, op_t op, size_t repeats);
+static bool same_bits(bitset_t * bitset, bitset_t * other);
+static bool matches_set(bitset_t * bitset, set_t * set, size_t * values);
+static bool run_size(size_t bits, bool timed, uint64_t * state);
+
+int main(int argc, char ** argv)
+{
+    bool check_only = (argc > 1) && (0 == strcmp(argv[1], "--check"));
+    size_t max_power = bench_arg(argc - check_only, argv + check_only, 1, 20);
+    uint64_t state = 88172645463325252u;
+    bool agree = true;
+
+    if (check_only)
+    {
+        for (size_t i = 0; i < sizeof(check_sizes) / sizeof(check_sizes[0]); i++)
+        {
+            agree = run_size(check_sizes[i], false, &state) && agree;
+        }
+    }
+    else
+    {
+        printf("%10s %11s %11s %11s %11s %11s %11s\n", "bits", "op", "scalar us", "sse2 us", "avx2 us", "sorted us", "hashed us");
+        for (size_t power = 10; power <= max_power; power += 2)
+        {
+            agree = run_size((size_t)1 << power, true, &state) && agree;
+        }
+    }
+
+    if (!agree)
+    {
+        fprintf(stderr, "Bitset paths or set_t disagree\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static bool run_size(size_t bits, bool timed, uint64_t * state)
+{
+    operands_t operands = {0};
+
+    if (load_operands(&operands, bits, state) != OK)
+    {
+        fprintf(stderr, "Could not build operands of %zu bits\n", bits);
+        free_operands(&operands);
+        return false;
+    }
+
+    // Repeats scale so each timing covers about the same number of words
+    size_t repeats = timed ? ((BITS_PER_SIZE / bits) > 0 ? (BITS_PER_SIZE / bits) : 1) : 0;
+    size_t set_repeats = (repeats / 256 > 0) ? repeats / 256 : 1;
+    bool agree = true;
+
+    for (op_t op = OP_UNION; op < OP_COUNT; op++)
+    {
+        double path_us[sizeof(paths) / sizeof(paths[0])] = {0};
+        bitset_t * reference = NULL;
+
+        for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+        {
+            uint64_t elapsed = 0;
+            bitset_t * result = result_for(&operands, paths[i], op, repeats, &elapsed);
+
+            if (NULL == result)
+            {
+                // The CPU lacks this path
+                path_us[i] = -1.0;
+                continue;
+            }
+
+            path_us[i] = (repeats > 0) ? (double)elapsed / 1e3 / (double)repeats : 0.0;
+
+            if (NULL == reference)
+            {
+                reference = result;
+                continue;
+            }
+
+            if (!same_bits(reference, result))
+            {
+                fprintf(stderr, "%zu bits %s: path %zu differs from scalar\n", bits, op_names[op], i);
+                agree = false;
+            }
+
+            bitset_destroy(result);
+        }
+
+        set_t * sorted = apply_set(operands.sorted_first, operands.sorted_second, op);
+        set_t * hashed = apply_set(operands.hashed_first, operands.hashed_second, op);
+
+        if (!matches_set(reference, sorted, operands.values) || !matches_set(reference, hashed, operands.values))
+        {
+            fprintf(stderr, "%zu bits %s: set_t differs from bitset\n", bits, op_names[op]);
+            agree = false;
+        }
+
+        set_destroy(sorted, NULL);
+        set_destroy(hashed, NULL);
+        bitset_destroy(reference);
+
+        if (timed)
+        {
+            printf("%10zu %11s", bits, op_names[op]);
+            for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+            {
+                if (path_us[i] < 0.0)
+                {
+                    printf(" %11s", "-");
+                }
+                else
+                {
+                    printf(" %11.3f", path_us[i]);
+                }
+            }
+
+            printf(" %11.3f %11.3f\n", time_set(operands.sorted_first, operands.sorted_second, op, set_repeats),
+                   time_set(operands.hashed_first, operands.hashed_second, op, set_repeats));
+        }
+    }
+
+    bitset_force_path(BITSET_PATH_AUTO);
+    free_operands(&operands);
+    return agree;
+}
+
+static bitset_t * result_for(operands_t * operands, bitset_path_t path, op_t op, size_t repeats, uint64_t * elapsed)
+{
+    if (bitset_force_path(path) != OK)
+    {
+        return NULL;
+    }
+
+    bitset_t * result = bitset_create(operands->bits);
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    // Repeating an op on its own result does the same work, so only the first pass is checked
+    bitset_union(result, operands->first);
+    apply_bitset(result, operands->second, op);
+
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < repeats; i++)
+    {
+        apply_bitset(result, operands->second, op);
+    }
+    *elapsed = bench_now() - begin;
+
+    return result;
+}
+
+static double time_set(set_t * set1, set_t * set2, op_t op, size_t repeats)
+{
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < repeats; i++)
+    {
+        set_destroy(apply_set(set1, set2, op), NULL);
+    }
+
+    return (double)(bench_now() - begin) / 1e3 / (double)repeats;
+}
+
+static int apply_bitset(bitset_t * bitset, bitset_t * other, op_t op)
+{
+    switch (op)
+    {
+        case OP_UNION:
+            return bitset_union(bitset, other);
+        case OP_INTERSECT:
+            return bitset_intersect(bitset, other);
+        default:
+            return bitset_difference(bitset, other);
+    }
+}
+
+static set_t * apply_set(set_t * set1, set_t * set2, op_t op)
+{
+    switch (op)
+    {
+        case OP_UNION:
+            return set_union(set1, set2);
+        case OP_INTERSECT:
+            return set_intersection(set1, set2);
+        default:
+            return set_difference(set1, set2);
+    }
+}
+
+static bool same_bits(bitset_t * bitset, bitset_t * other)
+{
+    // Padding bits are never set, so equal members means equal words
+    if (bitset_count(bitset) != bitset_count(other))
+    {
+        return false;
+    }
+
+    for (ssize_t bit = bitset_find_next(bitset, 0); bit >= 0; bit = bitset_find_next(bitset, (size_t)bit + 1))
+    {
+        if (!bitset_test(other, (size_t)bit))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool matches_set(bitset_t * bitset, set_t * set, size_t * values)
+{
+    if ((NULL == bitset) || (NULL == set) || (bitset_count(bitset) != set_get_size(set)))
+    {
+        return false;
+    }
+
+    for (ssize_t bit = bitset_find_next(bitset, 0); bit >= 0; bit = bitset_find_next(bitset, (size_t)bit + 1))
+    {
+        if (!set_contains(set, &(values[bit])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int load_operands(operands_t * operands, size_t bits, uint64_t * state)
+{
+    operands->bits = bits;
+    operands->values = malloc(bits * sizeof(size_t));
+    operands->first = bitset_create(bits);
+    operands->second = bitset_create(bits);
+    operands->sorted_first = set_create_sorted(bits, compare_values);
+    operands->sorted_second = set_create_sorted(bits, compare_values);
+    operands->hashed_first = set_create_hash(bits, compare_values, hash_value);
+    operands->hashed_second = set_create_hash(bits, compare_values, hash_value);
+
+    if ((NULL == operands->values) || (NULL == operands->first) || (NULL == operands->second) ||
+        (NULL == operands->sorted_first) || (NULL == operands->sorted_second) ||
+        (NULL == operands->hashed_first) || (NULL == operands->hashed_second))
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    for (size_t i = 0; i < bits; i++)
+    {
+        operands->values[i] = i;
+
+        if ((bench_random(state) % 100) < DENSITY_PERCENT)
+        {
+            bitset_set(operands->first, i);
+            set_add(operands->sorted_first, &(operands->values[i]));
+            set_add(operands->hashed_first, &(operands->values[i]));
+        }
+
+        if ((bench_random(state) % 100) < DENSITY_PERCENT)
+        {
+            bitset_set(operands->second, i);
+            set_add(operands->sorted_second, &(operands->values[i]));
+            set_add(operands->hashed_second, &(operands->values[i]));
+        }
+    }
+
+    return OK;
+}
+
+static void free_operands(operands_t * operands)
+{
+    bitset_destroy(operands->first);
+    bitset_destroy(operands->second);
+    set_destroy(operands->sorted_first, NULL);
+    set_destroy(operands->sorted_second, NULL);
+    set_destroy(operands->hashed_first, NULL);
+    set_destroy(operands->hashed_second, NULL);
+    free(operands->values);
+}
+
+static int compare_values(const void * arg1, const void * arg2)
+{
+    size_t value1 = *(const size_t *)arg1;
+    size_t value2 = *(const size_t *)arg2;
+    return (value1 > value2) - (value1 < value2);
+}
+
+static size_t hash_value(const void * arg)
+{
+    return *(const size_t *)arg;
+}
+// END OF SOURCE
\ No newline at end of file
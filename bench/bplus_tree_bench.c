@@ -0,0 +1,164 @@
+#include <bench.h>
+#include <binary_search_tree.h>
+#include <bplus_tree.h>
+#include <stdio.h>
+
+// Inserts n random keys into bplus_tree_t and search_tree_t, then times point
+// lookups of keys in the set and range scans about RANGE_WIDTH elements wide.
+// Usage: bplus_tree_bench [max power of ten, default 7]
+
+#define SCANS 1000
+#define RANGE_WIDTH 1000
+
+typedef struct timings
+{
+    double insert;
+    double lookup;
+    double scan;
+    size_t scanned;
+} timings_t;
+
+static int compare_keys(const void * arg1, const void * arg2);
+static void count_visit(void * data, void * arg);
+static int run_bplus(uint64_t * keys, size_t count, timings_t * timings);
+static int run_search_tree(uint64_t * keys, size_t count, timings_t * timings);
+
+int main(int argc, char ** argv)
+{
+    size_t max_power = bench_arg(argc, argv, 1, 7);
+
+    printf("%10s %12s %12s %12s %16s\n", "keys", "tree", "insert Mops", "lookup Mops", "scanned Melem/s");
+    size_t count = 100000;
+    for (size_t power = 5; power <= max_power; power++, count *= 10)
+    {
+        uint64_t * keys = malloc(count * sizeof(*keys));
+
+        if (NULL == keys)
+        {
+            fprintf(stderr, "Not enough memory for %zu keys\n", count);
+            return 1;
+        }
+
+        uint64_t state = 88172645463325252u;
+        for (size_t i = 0; i < count; i++)
+        {
+            keys[i] = bench_random(&state);
+        }
+
+        timings_t bplus = {0};
+        timings_t search = {0};
+        if ((run_bplus(keys, count, &bplus) != OK) || (run_search_tree(keys, count, &search) != OK))
+        {
+            fprintf(stderr, "Could not create the trees for %zu keys\n", count);
+            free(keys);
+            return 1;
+        }
+
+        printf("%10zu %12s %12.2f %12.2f %16.2f\n", count, "bplus_tree", bplus.insert, bplus.lookup, bplus.scan);
+        printf("%10zu %12s %12.2f %12.2f %16.2f\n", count, "search_tree", search.insert, search.lookup, search.scan);
+        free(keys);
+
+        if (bplus.scanned != search.scanned)
+        {
+            fprintf(stderr, "Range scans disagree: %zu and %zu elements\n", bplus.scanned, search.scanned);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int run_bplus(uint64_t * keys, size_t count, timings_t * timings)
+{
+    bplus_tree_t * tree = bplus_tree_create(compare_keys, NULL);
+
+    if (NULL == tree)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < count; i++)
+    {
+        bplus_tree_insert(tree, &(keys[i]));
+    }
+    timings->insert = bench_mops(count, bench_now() - begin);
+
+    // Lookups walk the keys in a scattered order so neither tree gets a warm path
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    size_t found = 0;
+    begin = bench_now();
+    for (size_t i = 0; i < count; i++)
+    {
+        found += (bplus_tree_search(tree, &(keys[bench_random(&state) % count])) != NULL);
+    }
+    timings->lookup = bench_mops(found, bench_now() - begin);
+
+    // A window of RANGE_WIDTH / count of the key space holds about RANGE_WIDTH keys
+    uint64_t width = (UINT64_MAX / count) * RANGE_WIDTH;
+    begin = bench_now();
+    for (size_t i = 0; i < SCANS; i++)
+    {
+        uint64_t lo = keys[(i * 7919) % count];
+        uint64_t hi = (lo > UINT64_MAX - width) ? UINT64_MAX : lo + width;
+        bplus_tree_range(tree, &lo, &hi, count_visit, &(timings->scanned));
+    }
+    timings->scan = bench_mops(timings->scanned, bench_now() - begin);
+
+    bplus_tree_destroy(tree);
+    return OK;
+}
+
+static int run_search_tree(uint64_t * keys, size_t count, timings_t * timings)
+{
+    search_tree_t * tree = search_tree_create(compare_keys, NULL);
+
+    if (NULL == tree)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < count; i++)
+    {
+        search_tree_insert(tree, &(keys[i]));
+    }
+    timings->insert = bench_mops(count, bench_now() - begin);
+
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    size_t found = 0;
+    begin = bench_now();
+    for (size_t i = 0; i < count; i++)
+    {
+        found += (search_tree_search(tree, &(keys[bench_random(&state) % count])) != NULL);
+    }
+    timings->lookup = bench_mops(found, bench_now() - begin);
+
+    uint64_t width = (UINT64_MAX / count) * RANGE_WIDTH;
+    begin = bench_now();
+    for (size_t i = 0; i < SCANS; i++)
+    {
+        uint64_t lo = keys[(i * 7919) % count];
+        uint64_t hi = (lo > UINT64_MAX - width) ? UINT64_MAX : lo + width;
+        search_tree_range(tree, &lo, &hi, count_visit, &(timings->scanned));
+    }
+    timings->scan = bench_mops(timings->scanned, bench_now() - begin);
+
+    search_tree_destroy(tree);
+    return OK;
+}
+
+static int compare_keys(const void * arg1, const void * arg2)
+{
+    // Positive when the first key sorts first, as both trees expect
+    uint64_t key1 = *(const uint64_t *)arg1;
+    uint64_t key2 = *(const uint64_t *)arg2;
+    return (key1 < key2) - (key1 > key2);
+}
+
+static void count_visit(void * data, void * arg)
+{
+    (void)data;
+    (*(size_t *)arg)++;
+}
+// END OF SOURCE
\ No newline at end of file
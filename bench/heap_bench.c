@@ -0,0 +1,77 @@
+#include <bench.h>
+#include <heap.h>
+#include <stdio.h>
+
+// Inserts n random keys then extracts them all, for heap_create's binary
+// layout and the 4 and 8 way layouts from heap_create_arity.
+// Usage: heap_bench [max power of ten, default 8]
+
+static const size_t arities[] = {2, 4, 8};
+
+static int compare_keys(const void * arg1, const void * arg2);
+
+int main(int argc, char ** argv)
+{
+    size_t max_power = bench_arg(argc, argv, 1, 8);
+
+    printf("%12s %6s %14s %14s\n", "elements", "arity", "insert Mops", "extract Mops");
+    size_t count = 1000;
+    for (size_t power = 3; power <= max_power; power++, count *= 10)
+    {
+        uint64_t * keys = malloc(count * sizeof(*keys));
+
+        if (NULL == keys)
+        {
+            fprintf(stderr, "Not enough memory for %zu keys\n", count);
+            return 1;
+        }
+
+        uint64_t state = 88172645463325252u;
+        for (size_t i = 0; i < count; i++)
+        {
+            keys[i] = bench_random(&state);
+        }
+
+        for (size_t i = 0; i < sizeof(arities) / sizeof(arities[0]); i++)
+        {
+            // Arity 2 goes through heap_create as the baseline
+            heap_t * heap = (2 == arities[i]) ? heap_create(count, compare_keys)
+                                              : heap_create_arity(count, compare_keys, arities[i]);
+
+            if (NULL == heap)
+            {
+                fprintf(stderr, "Could not create a heap of %zu\n", count);
+                free(keys);
+                return 1;
+            }
+
+            uint64_t begin = bench_now();
+            for (size_t j = 0; j < count; j++)
+            {
+                heap_insert(heap, &(keys[j]), &(keys[j]));
+            }
+            uint64_t inserted = bench_now();
+            for (size_t j = 0; j < count; j++)
+            {
+                heap_extract(heap, NULL);
+            }
+            uint64_t extracted = bench_now();
+
+            printf("%12zu %6zu %14.2f %14.2f\n", count, arities[i],
+                   bench_mops(count, inserted - begin), bench_mops(count, extracted - inserted));
+            heap_destroy(heap, NULL, NULL);
+        }
+
+        free(keys);
+    }
+
+    return 0;
+}
+
+static int compare_keys(const void * arg1, const void * arg2)
+{
+    uint64_t key1 = *(const uint64_t *)arg1;
+    uint64_t key2 = *(const uint64_t *)arg2;
+    return (key1 > key2) - (key1 < key2);
+}
+// END OF SOURCE
\ No newline at end of file
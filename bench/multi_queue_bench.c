@@ -0,0 +1,313 @@
+#include <bench.h>
+#include <heap.h>
+#include <multi_queue.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Every thread runs insert, extract pairs on one shared queue. The first table
+// compares multi_queue_t to a single mutex guarded heap_t over thread counts,
+// the second sweeps factor and choices at the most threads.
+// True rank error is measured offline: each operation takes a ticket from a
+// shared counter, and replaying the tickets in order through
+// a Fenwick tree gives how many queued keys were smaller than each one extracted.
+// Usage: multi_queue_bench [max threads] [pairs per thread] [prefill]
+
+#define FACTOR 2
+#define CHOICES 2
+// Pairs per thread in the rank runs, the replay log holds one entry per operation
+#define RANK_PAIRS 100000
+
+static const size_t factors[] = {1, 2, 4, 8};
+static const size_t choices[] = {1, 2, 4};
+
+typedef struct event
+{
+    uint32_t key;
+    bool extract;
+} event_t;
+
+typedef struct bench_run
+{
+    multi_queue_t * queue;
+    heap_t * heap;
+    pthread_mutex_t lock;
+    uint32_t * keys;
+    _Atomic size_t next_key;
+    // NULL unless the run is logged for the rank replay
+    event_t * events;
+    _Atomic size_t next_ticket;
+    size_t pairs;
+    pthread_barrier_t start;
+} bench_run_t;
+
+typedef struct rank_summary
+{
+    double mean;
+    size_t p99;
+    size_t max;
+} rank_summary_t;
+
+static int compare_keys(const void * arg1, const void * arg2);
+static void * run_thread(void * arg);
+static double run_queue(bench_run_t * run, size_t threads, size_t pairs, size_t prefill);
+static void prepare_run(bench_run_t * run, uint32_t * keys, size_t prefill);
+static void log_event(bench_run_t * run, uint32_t * key, bool extract);
+static rank_summary_t replay_ranks(event_t * events, size_t count, size_t universe);
+static int compare_sizes(const void * arg1, const void * arg2);
+
+int main(int argc, char ** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = bench_arg(argc, argv, 1, (cpus > 0) ? (size_t)cpus : 1);
+    size_t pairs = bench_arg(argc, argv, 2, 1000000);
+    size_t prefill = bench_arg(argc, argv, 3, 100000);
+
+    // Keys are a shuffled 0 .. universe - 1, every insert takes the next one so all keys are distinct
+    size_t most_pairs = (pairs > RANK_PAIRS) ? pairs : RANK_PAIRS;
+    size_t universe = prefill + (max_threads * most_pairs);
+    uint32_t * keys = malloc(universe * sizeof(*keys));
+    event_t * events = malloc((prefill + (max_threads * RANK_PAIRS * 2)) * sizeof(*events));
+
+    if ((0 == max_threads) || (NULL == keys) || (NULL == events) || (universe > UINT32_MAX))
+    {
+        fprintf(stderr, "Could not set up the run\n");
+        return 1;
+    }
+
+    uint64_t state = 88172645463325252u;
+    for (size_t i = 0; i < universe; i++)
+    {
+        keys[i] = (uint32_t)i;
+    }
+
+    for (size_t i = universe - 1; i > 0; i--)
+    {
+        size_t pick = (size_t)(bench_random(&state) % (i + 1));
+        uint32_t swap = keys[i];
+        keys[i] = keys[pick];
+        keys[pick] = swap;
+    }
+
+    printf("factor %d, choices %d, %zu prefilled\n", FACTOR, CHOICES, prefill);
+    printf("%8s %14s %14s\n", "threads", "locked Mops", "multi Mops");
+    for (size_t threads = 1; threads <= max_threads; threads++)
+    {
+        bench_run_t run = {0};
+        prepare_run(&run, keys, prefill);
+        run.heap = heap_create(prefill + threads, compare_keys);
+        double locked = run_queue(&run, threads, pairs, prefill);
+        heap_destroy(run.heap, NULL, NULL);
+
+        prepare_run(&run, keys, prefill);
+        run.queue = multi_queue_create(threads, FACTOR, CHOICES, compare_keys);
+        double multi = run_queue(&run, threads, pairs, prefill);
+        multi_queue_destroy(run.queue, NULL, NULL);
+
+        printf("%8zu %14.2f %14.2f\n", threads, locked, multi);
+    }
+
+    // Throughput runs without logging or stats, the rank runs are separate and untimed
+    printf("\n%zu threads, rank error over %d pairs per thread\n", max_threads, RANK_PAIRS);
+    printf("%8s %8s %12s %12s %10s %10s %12s %12s\n", "factor", "choices", "multi Mops",
+           "rank mean", "rank p99", "rank max", "proxy mean", "skipped");
+    for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); i++)
+    {
+        for (size_t j = 0; j < sizeof(choices) / sizeof(choices[0]); j++)
+        {
+            bench_run_t run = {0};
+            prepare_run(&run, keys, prefill);
+            run.queue = multi_queue_create(max_threads, factors[i], choices[j], compare_keys);
+            double multi = run_queue(&run, max_threads, pairs, prefill);
+            multi_queue_destroy(run.queue, NULL, NULL);
+
+            prepare_run(&run, keys, prefill);
+            run.queue = multi_queue_create(max_threads, factors[i], choices[j], compare_keys);
+            run.events = events;
+            multi_queue_set_stats(run.queue, true);
+            run_queue(&run, max_threads, RANK_PAIRS, prefill);
+
+            multi_queue_stats_t stats = {0};
+            multi_queue_get_stats(run.queue, &stats);
+            multi_queue_destroy(run.queue, NULL, NULL);
+            rank_summary_t ranks = replay_ranks(events, atomic_load(&(run.next_ticket)), universe);
+
+            printf("%8zu %8zu %12.2f %12.2f %10zu %10zu %12.2f %12zu\n", factors[i], choices[j], multi,
+                   ranks.mean, ranks.p99, ranks.max,
+                   (stats.extracts > 0) ? (double)stats.rank_error_sum / (double)stats.extracts : 0.0, stats.skipped);
+        }
+    }
+
+    free(events);
+    free(keys);
+    return 0;
+}
+
+static void prepare_run(bench_run_t * run, uint32_t * keys, size_t prefill)
+{
+    run->queue = NULL;
+    run->heap = NULL;
+    run->keys = keys;
+    run->events = NULL;
+    atomic_store(&(run->next_key), prefill);
+    atomic_store(&(run->next_ticket), 0);
+}
+
+static double run_queue(bench_run_t * run, size_t threads, size_t pairs, size_t prefill)
+{
+    run->pairs = pairs;
+    pthread_mutex_init(&(run->lock), NULL);
+    pthread_barrier_init(&(run->start), NULL, (unsigned)threads + 1);
+
+    // Keep elements underneath so extracts never see an empty queue
+    for (size_t i = 0; i < prefill; i++)
+    {
+        log_event(run, &(run->keys[i]), false);
+
+        if (run->queue != NULL)
+        {
+            multi_queue_insert(run->queue, &(run->keys[i]), &(run->keys[i]));
+        }
+        else
+        {
+            heap_insert(run->heap, &(run->keys[i]), &(run->keys[i]));
+        }
+    }
+
+    pthread_t * workers = calloc(threads, sizeof(*workers));
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_create(&(workers[i]), NULL, run_thread, run);
+    }
+
+    pthread_barrier_wait(&(run->start));
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    uint64_t elapsed = bench_now() - begin;
+
+    free(workers);
+    pthread_barrier_destroy(&(run->start));
+    pthread_mutex_destroy(&(run->lock));
+    return bench_mops(threads * pairs * 2, elapsed);
+}
+
+static void * run_thread(void * arg)
+{
+    bench_run_t * run = arg;
+    pthread_barrier_wait(&(run->start));
+
+    for (size_t i = 0; i < run->pairs; i++)
+    {
+        uint32_t * key = &(run->keys[atomic_fetch_add_explicit(&(run->next_key), 1, memory_order_relaxed)]);
+        uint32_t * extracted = NULL;
+
+        if (run->queue != NULL)
+        {
+            log_event(run, key, false);
+            multi_queue_insert(run->queue, key, key);
+            extracted = multi_queue_extract(run->queue);
+        }
+        else
+        {
+            pthread_mutex_lock(&(run->lock));
+            heap_insert(run->heap, key, key);
+            pthread_mutex_unlock(&(run->lock));
+
+            pthread_mutex_lock(&(run->lock));
+            extracted = heap_extract(run->heap, NULL);
+            pthread_mutex_unlock(&(run->lock));
+        }
+
+        if (extracted != NULL)
+        {
+            log_event(run, extracted, true);
+        }
+    }
+
+    return NULL;
+}
+
+static void log_event(bench_run_t * run, uint32_t * key, bool extract)
+{
+    if (NULL == run->events)
+    {
+        return;
+    }
+
+    // Inserts take their ticket before the operation and extracts after it, so a key is
+    // always in the replay before it can come out. The order is a close stand in for the real one.
+    size_t ticket = atomic_fetch_add(&(run->next_ticket), 1);
+    run->events[ticket].key = *key;
+    run->events[ticket].extract = extract;
+}
+
+static rank_summary_t replay_ranks(event_t * events, size_t count, size_t universe)
+{
+    // Fenwick tree over the key space, counting the keys queued at each point of the replay
+    rank_summary_t summary = {0};
+    size_t * tree = calloc(universe + 1, sizeof(*tree));
+    size_t * ranks = malloc(count * sizeof(*ranks));
+    size_t extracts = 0;
+    size_t sum = 0;
+
+    if ((NULL == tree) || (NULL == ranks))
+    {
+        free(tree);
+        free(ranks);
+        return summary;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t position = (size_t)events[i].key + 1;
+
+        if (events[i].extract)
+        {
+            // Queued keys below this one, 0 for an exact minimum
+            size_t rank = 0;
+            for (size_t j = position - 1; j > 0; j -= j & (~j + 1))
+            {
+                rank += tree[j];
+            }
+
+            ranks[extracts++] = rank;
+            sum += rank;
+        }
+
+        for (size_t j = position; j <= universe; j += j & (~j + 1))
+        {
+            tree[j] += events[i].extract ? (size_t)-1 : 1;
+        }
+    }
+
+    if (extracts > 0)
+    {
+        qsort(ranks, extracts, sizeof(*ranks), compare_sizes);
+        summary.mean = (double)sum / (double)extracts;
+        summary.p99 = ranks[(extracts * 99) / 100];
+        summary.max = ranks[extracts - 1];
+    }
+
+    free(tree);
+    free(ranks);
+    return summary;
+}
+
+static int compare_keys(const void * arg1, const void * arg2)
+{
+    uint32_t key1 = *(const uint32_t *)arg1;
+    uint32_t key2 = *(const uint32_t *)arg2;
+    return (key1 > key2) - (key1 < key2);
+}
+
+static int compare_sizes(const void * arg1, const void * arg2)
+{
+    size_t size1 = *(const size_t *)arg1;
+    size_t size2 = *(const size_t *)arg2;
+    return (size1 > size2) - (size1 < size2);
+}
+// END OF SOURCE
\ No newline at end of file
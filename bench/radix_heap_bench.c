@@ -0,0 +1,285 @@
+#include <bench.h>
+#include <graph.h>
+#include <heap.h>
+#include <radix_heap.h>
+#include <stdio.h>
+
+// Runs lazy deletion Dijkstra from a number of sources on a random graph_t,
+// once with radix_heap_t and once with heap_t as the queue. Dijkstra only
+// ever inserts keys at or above the last one extracted, the monotone trace
+// radix_heap_t is built for.
+// Usage: radix_heap_bench [vertices] [edges per vertex] [sources]
+
+typedef struct entry
+{
+    uint64_t distance;
+    uint32_t vertex;
+} entry_t;
+
+typedef struct adjacency
+{
+    size_t * offsets;
+    uint32_t * targets;
+    uint32_t * weights;
+    uint32_t vertices;
+} adjacency_t;
+
+static int compare_ids(const void * arg1, const void * arg2);
+static int compare_entries(const void * arg1, const void * arg2);
+static int load_adjacency(adjacency_t * adjacency, uint32_t vertices, size_t degree);
+static uint64_t run_radix(adjacency_t * adjacency, uint32_t source, uint64_t * distance, size_t * operations);
+static uint64_t run_heap(adjacency_t * adjacency, uint32_t source, uint64_t * distance, entry_t * pool, size_t * operations);
+
+int main(int argc, char ** argv)
+{
+    uint32_t vertices = (uint32_t)bench_arg(argc, argv, 1, 2000);
+    size_t degree = bench_arg(argc, argv, 2, 8);
+    size_t sources = bench_arg(argc, argv, 3, 50);
+
+    adjacency_t adjacency = {0};
+
+    if ((vertices < 2) || (load_adjacency(&adjacency, vertices, degree) != OK))
+    {
+        fprintf(stderr, "Could not build the graph\n");
+        return 1;
+    }
+
+    uint64_t * distance = malloc(vertices * sizeof(*distance));
+    entry_t * pool = malloc((adjacency.offsets[vertices] + 1) * sizeof(*pool));
+    uint64_t radix_time = 0;
+    uint64_t heap_time = 0;
+    uint64_t radix_sum = 0;
+    uint64_t heap_sum = 0;
+    size_t radix_operations = 0;
+    size_t heap_operations = 0;
+
+    for (size_t i = 0; i < sources; i++)
+    {
+        uint32_t source = (uint32_t)((i * 7919) % vertices);
+
+        uint64_t begin = bench_now();
+        radix_sum += run_radix(&adjacency, source, distance, &radix_operations);
+        radix_time += bench_now() - begin;
+
+        begin = bench_now();
+        heap_sum += run_heap(&adjacency, source, distance, pool, &heap_operations);
+        heap_time += bench_now() - begin;
+    }
+
+    printf("%u vertices, %zu edges, %zu sources\n", vertices, adjacency.offsets[vertices], sources);
+    printf("%12s %14s %12s %12s\n", "queue", "operations", "ms", "Mops");
+    printf("%12s %14zu %12.1f %12.2f\n", "radix_heap", radix_operations, (double)radix_time / 1e6, bench_mops(radix_operations, radix_time));
+    printf("%12s %14zu %12.1f %12.2f\n", "heap", heap_operations, (double)heap_time / 1e6, bench_mops(heap_operations, heap_time));
+
+    if (radix_sum != heap_sum)
+    {
+        fprintf(stderr, "Shortest path sums differ: %llu and %llu\n", (unsigned long long)radix_sum, (unsigned long long)heap_sum);
+        return 1;
+    }
+
+    free(pool);
+    free(distance);
+    free(adjacency.offsets);
+    free(adjacency.targets);
+    free(adjacency.weights);
+    return 0;
+}
+
+static int compare_ids(const void * arg1, const void * arg2)
+{
+    uint32_t id1 = *(const uint32_t *)arg1;
+    uint32_t id2 = *(const uint32_t *)arg2;
+    return (id1 > id2) - (id1 < id2);
+}
+
+static int compare_entries(const void * arg1, const void * arg2)
+{
+    uint64_t distance1 = ((const entry_t *)arg1)->distance;
+    uint64_t distance2 = ((const entry_t *)arg2)->distance;
+    return (distance1 > distance2) - (distance1 < distance2);
+}
+
+static int load_adjacency(adjacency_t * adjacency, uint32_t vertices, size_t degree)
+{
+    // Edges go into a graph_t, then are read back out of it into flat arrays,
+    // since graph_t finds vertices by a linear scan and would swamp the queue costs
+    graph_t * graph = graph_create(vertices, compare_ids);
+    uint32_t * ids = malloc(vertices * sizeof(*ids));
+    size_t pairs = (size_t)vertices * degree;
+    uint32_t * ends = malloc(pairs * 2 * sizeof(*ends));
+
+    if ((NULL == graph) || (NULL == ids) || (NULL == ends))
+    {
+        graph_destroy(graph, NULL);
+        free(ids);
+        free(ends);
+        return ALLOCATION_ERROR;
+    }
+
+    for (uint32_t i = 0; i < vertices; i++)
+    {
+        ids[i] = i;
+        graph_add_node(graph, &(ids[i]));
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    for (size_t i = 0; i < pairs; i++)
+    {
+        uint32_t from = (uint32_t)(i / degree);
+        uint32_t to = (uint32_t)(bench_random(&state) % (vertices - 1));
+        to += (to >= from) ? 1 : 0;
+        ends[2 * i] = from;
+        ends[(2 * i) + 1] = to;
+        graph_update_edge(graph, &(ids[from]), &(ids[to]), (uint32_t)(bench_random(&state) % 1000) + 1);
+    }
+
+    // Edges are undirected, every pair is listed from both ends
+    adjacency->vertices = vertices;
+    adjacency->offsets = calloc((size_t)vertices + 1, sizeof(size_t));
+    adjacency->targets = malloc(pairs * 2 * sizeof(uint32_t));
+    adjacency->weights = malloc(pairs * 2 * sizeof(uint32_t));
+
+    if ((NULL == adjacency->offsets) || (NULL == adjacency->targets) || (NULL == adjacency->weights))
+    {
+        graph_destroy(graph, NULL);
+        free(ids);
+        free(ends);
+        return ALLOCATION_ERROR;
+    }
+
+    for (size_t i = 0; i < pairs * 2; i++)
+    {
+        adjacency->offsets[ends[i] + 1]++;
+    }
+
+    for (uint32_t i = 0; i < vertices; i++)
+    {
+        adjacency->offsets[i + 1] += adjacency->offsets[i];
+    }
+
+    size_t * fill = calloc(vertices, sizeof(*fill));
+    for (size_t i = 0; i < pairs; i++)
+    {
+        uint32_t from = ends[2 * i];
+        uint32_t to = ends[(2 * i) + 1];
+        uint32_t weight = graph_get_edge(graph, &(ids[from]), &(ids[to]));
+
+        size_t slot = adjacency->offsets[from] + fill[from]++;
+        adjacency->targets[slot] = to;
+        adjacency->weights[slot] = weight;
+        slot = adjacency->offsets[to] + fill[to]++;
+        adjacency->targets[slot] = from;
+        adjacency->weights[slot] = weight;
+    }
+
+    free(fill);
+    free(ends);
+    free(ids);
+    graph_destroy(graph, NULL);
+    return OK;
+}
+
+static uint64_t run_radix(adjacency_t * adjacency, uint32_t source, uint64_t * distance, size_t * operations)
+{
+    for (uint32_t i = 0; i < adjacency->vertices; i++)
+    {
+        distance[i] = UINT64_MAX;
+    }
+
+    // Vertex numbers ride in the data pointer, offset by one so vertex 0 is not NULL
+    radix_heap_t * heap = radix_heap_create(adjacency->vertices);
+    distance[source] = 0;
+    radix_heap_insert(heap, 0, (void *)(uintptr_t)(source + 1));
+    (*operations)++;
+
+    uint64_t key = 0;
+    void * data = NULL;
+    while ((data = radix_heap_extract(heap, &key)) != NULL)
+    {
+        (*operations)++;
+        uint32_t vertex = (uint32_t)((uintptr_t)data - 1);
+
+        if (key != distance[vertex])
+        {
+            // Stale entry left behind by a later, shorter path
+            continue;
+        }
+
+        for (size_t i = adjacency->offsets[vertex]; i < adjacency->offsets[vertex + 1]; i++)
+        {
+            uint64_t candidate = key + adjacency->weights[i];
+            uint32_t target = adjacency->targets[i];
+
+            if (candidate < distance[target])
+            {
+                distance[target] = candidate;
+                radix_heap_insert(heap, candidate, (void *)(uintptr_t)(target + 1));
+                (*operations)++;
+            }
+        }
+    }
+
+    radix_heap_destroy(heap, NULL);
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < adjacency->vertices; i++)
+    {
+        sum += (distance[i] != UINT64_MAX) ? distance[i] : 0;
+    }
+
+    return sum;
+}
+
+static uint64_t run_heap(adjacency_t * adjacency, uint32_t source, uint64_t * distance, entry_t * pool, size_t * operations)
+{
+    for (uint32_t i = 0; i < adjacency->vertices; i++)
+    {
+        distance[i] = UINT64_MAX;
+    }
+
+    // Each push takes a fresh entry, there is at most one per edge plus the source
+    heap_t * heap = heap_create(adjacency->vertices, compare_entries);
+    size_t used = 0;
+    distance[source] = 0;
+    pool[used] = (entry_t){0, source};
+    heap_insert(heap, &(pool[used]), &(pool[used]));
+    used++;
+    (*operations)++;
+
+    entry_t * entry = NULL;
+    while ((entry = heap_extract(heap, NULL)) != NULL)
+    {
+        (*operations)++;
+
+        if (entry->distance != distance[entry->vertex])
+        {
+            continue;
+        }
+
+        for (size_t i = adjacency->offsets[entry->vertex]; i < adjacency->offsets[entry->vertex + 1]; i++)
+        {
+            uint64_t candidate = entry->distance + adjacency->weights[i];
+            uint32_t target = adjacency->targets[i];
+
+            if (candidate < distance[target])
+            {
+                distance[target] = candidate;
+                pool[used] = (entry_t){candidate, target};
+                heap_insert(heap, &(pool[used]), &(pool[used]));
+                used++;
+                (*operations)++;
+            }
+        }
+    }
+
+    heap_destroy(heap, NULL, NULL);
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < adjacency->vertices; i++)
+    {
+        sum += (distance[i] != UINT64_MAX) ? distance[i] : 0;
+    }
+
+    return sum;
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <bench.h>
+#include <binary_search_tree.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Keeps a search_tree_t at about n keys under a random mix of inserts and
+// deletes, printing the tree height and the average search latency as it goes.
+// Usage: search_tree_bench [keys, default 10^6] [operations, default 10^7] [report every, default 10^6]
+
+#define PROBES 100000
+
+typedef struct workload
+{
+    uint64_t * keys;
+    bool * present;
+    size_t universe;
+    uint64_t state;
+} workload_t;
+
+static int compare_keys(const void * arg1, const void * arg2);
+static size_t pick_key(workload_t * workload, bool present);
+static double search_latency(search_tree_t * tree, workload_t * workload);
+static size_t floor_log2(size_t value);
+
+int main(int argc, char ** argv)
+{
+    size_t count = bench_arg(argc, argv, 1, 1000000);
+    size_t operations = bench_arg(argc, argv, 2, 10000000);
+    size_t interval = bench_arg(argc, argv, 3, 1000000);
+
+    // Twice as many possible keys as live ones, so picking either kind takes about two tries
+    workload_t workload = {.universe = count * 2, .state = 88172645463325252u};
+    workload.keys = malloc(workload.universe * sizeof(*(workload.keys)));
+    workload.present = calloc(workload.universe, sizeof(*(workload.present)));
+    search_tree_t * tree = search_tree_create(compare_keys, NULL);
+
+    if ((0 == count) || (0 == interval) || (NULL == workload.keys) || (NULL == workload.present) || (NULL == tree))
+    {
+        fprintf(stderr, "Could not set up the run\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < workload.universe; i++)
+    {
+        workload.keys[i] = bench_random(&(workload.state));
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t pick = pick_key(&workload, false);
+        workload.present[pick] = true;
+        search_tree_insert(tree, &(workload.keys[pick]));
+    }
+
+    printf("%14s %10s %8s %8s %12s %12s\n", "operations", "size", "height", "log2 n", "update Mops", "search ns");
+    printf("%14d %10zu %8zu %8zu %12s %12.1f\n", 0, search_tree_get_size(tree), search_tree_get_height(tree),
+           floor_log2(search_tree_get_size(tree)), "-", search_latency(tree, &workload));
+
+    for (size_t done = 0; done < operations;)
+    {
+        size_t batch = (operations - done < interval) ? operations - done : interval;
+
+        uint64_t begin = bench_now();
+        for (size_t i = 0; i < batch; i++)
+        {
+            // Lean towards whichever side keeps the size near count
+            bool insert = (bench_random(&(workload.state)) % (2 * count)) >= search_tree_get_size(tree);
+            size_t pick = pick_key(&workload, !insert);
+            workload.present[pick] = insert;
+
+            if (insert)
+            {
+                search_tree_insert(tree, &(workload.keys[pick]));
+            }
+            else
+            {
+                search_tree_delete(tree, &(workload.keys[pick]));
+            }
+        }
+        uint64_t elapsed = bench_now() - begin;
+        done += batch;
+
+        size_t size = search_tree_get_size(tree);
+        printf("%14zu %10zu %8zu %8zu %12.2f %12.1f\n", done, size, search_tree_get_height(tree), floor_log2(size),
+               bench_mops(batch, elapsed), search_latency(tree, &workload));
+    }
+
+    search_tree_destroy(tree);
+    free(workload.present);
+    free(workload.keys);
+    return 0;
+}
+
+static int compare_keys(const void * arg1, const void * arg2)
+{
+    // Positive when the first key sorts first, as the tree expects
+    uint64_t key1 = *(const uint64_t *)arg1;
+    uint64_t key2 = *(const uint64_t *)arg2;
+    return (key1 < key2) - (key1 > key2);
+}
+
+static size_t pick_key(workload_t * workload, bool present)
+{
+    size_t pick = 0;
+    do
+    {
+        pick = (size_t)(bench_random(&(workload->state)) % workload->universe);
+    } while (workload->present[pick] != present);
+
+    return pick;
+}
+
+static double search_latency(search_tree_t * tree, workload_t * workload)
+{
+    // Half the probes hit, half miss
+    size_t found = 0;
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < PROBES; i++)
+    {
+        size_t pick = (size_t)(bench_random(&(workload->state)) % workload->universe);
+        found += (search_tree_search(tree, &(workload->keys[pick])) != NULL);
+    }
+    uint64_t elapsed = bench_now() - begin;
+
+    // Keeps the searches from being optimised away
+    if (found > PROBES)
+    {
+        fputs("Impossible hit count\n", stderr);
+    }
+
+    return (double)elapsed / (double)PROBES;
+}
+
+static size_t floor_log2(size_t value)
+{
+    return (value > 1) ? (size_t)(63 - __builtin_clzll((unsigned long long)value)) : 0;
+}
+// END OF SOURCE
\ No newline at end of file
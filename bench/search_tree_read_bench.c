@@ -0,0 +1,207 @@
+#include <bench.h>
+#include <binary_search_tree.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Read heavy mix, 99 searches to 1 insert or delete, over 1..N threads on one
+// search_tree_t. Compared for a plain tree behind a mutex, behind a rwlock,
+// and SEARCH_TREE_CONCURRENT with its optimistic searches.
+// Usage: search_tree_read_bench [max threads] [operations per thread] [keys]
+
+#define WRITE_PERMILLE 10
+
+typedef enum {MUTEX, RWLOCK, OPTIMISTIC, VARIANT_SZ} variant_t;
+
+typedef struct bench_run
+{
+    variant_t variant;
+    search_tree_t * tree;
+    pthread_mutex_t mutex;
+    pthread_rwlock_t rwlock;
+    uint64_t * keys;
+    // Each key is only written by the thread owning it, index % threads
+    bool * present;
+    size_t universe;
+    size_t threads;
+    size_t operations;
+    _Atomic size_t next_thread;
+    pthread_barrier_t start;
+} bench_run_t;
+
+static int compare_keys(const void * arg1, const void * arg2);
+static void * run_thread(void * arg);
+static double run_variant(variant_t variant, size_t threads, size_t operations, uint64_t * keys, bool * present, size_t universe);
+
+int main(int argc, char ** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = bench_arg(argc, argv, 1, (cpus > 0) ? (size_t)cpus : 1);
+    size_t operations = bench_arg(argc, argv, 2, 1000000);
+    size_t count = bench_arg(argc, argv, 3, 100000);
+
+    // Half the possible keys are in the tree at the start, writes toggle one of them
+    size_t universe = count * 2;
+    uint64_t * keys = malloc(universe * sizeof(*keys));
+    bool * present = malloc(universe * sizeof(*present));
+
+    if ((0 == count) || (NULL == keys) || (NULL == present))
+    {
+        fprintf(stderr, "Could not set up the run\n");
+        return 1;
+    }
+
+    uint64_t state = 88172645463325252u;
+    for (size_t i = 0; i < universe; i++)
+    {
+        keys[i] = bench_random(&state);
+    }
+
+    printf("%zu keys, %d in 1000 operations write\n", count, WRITE_PERMILLE);
+    printf("%8s %14s %14s %16s\n", "threads", "mutex Mops", "rwlock Mops", "optimistic Mops");
+    for (size_t threads = 1; threads <= max_threads; threads++)
+    {
+        double results[VARIANT_SZ] = {0};
+        for (variant_t variant = MUTEX; variant < VARIANT_SZ; variant++)
+        {
+            results[variant] = run_variant(variant, threads, operations, keys, present, universe);
+        }
+
+        printf("%8zu %14.2f %14.2f %16.2f\n", threads, results[MUTEX], results[RWLOCK], results[OPTIMISTIC]);
+    }
+
+    free(present);
+    free(keys);
+    return 0;
+}
+
+static double run_variant(variant_t variant, size_t threads, size_t operations, uint64_t * keys, bool * present, size_t universe)
+{
+    bench_run_t run = {.variant = variant, .keys = keys, .present = present, .universe = universe,
+                       .threads = threads, .operations = operations};
+    pthread_mutex_init(&(run.mutex), NULL);
+    pthread_rwlock_init(&(run.rwlock), NULL);
+    pthread_barrier_init(&(run.start), NULL, (unsigned)threads + 1);
+    run.tree = search_tree_create_flags(compare_keys, NULL, (OPTIMISTIC == variant) ? SEARCH_TREE_CONCURRENT : 0);
+
+    for (size_t i = 0; i < universe; i++)
+    {
+        present[i] = (0 == (i % 2));
+
+        if (present[i])
+        {
+            search_tree_insert(run.tree, &(keys[i]));
+        }
+    }
+
+    pthread_t * workers = calloc(threads, sizeof(*workers));
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_create(&(workers[i]), NULL, run_thread, &run);
+    }
+
+    pthread_barrier_wait(&(run.start));
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    uint64_t elapsed = bench_now() - begin;
+
+    free(workers);
+    search_tree_destroy(run.tree);
+    pthread_barrier_destroy(&(run.start));
+    pthread_rwlock_destroy(&(run.rwlock));
+    pthread_mutex_destroy(&(run.mutex));
+    return bench_mops(threads * operations, elapsed);
+}
+
+static void * run_thread(void * arg)
+{
+    bench_run_t * run = arg;
+    size_t self = atomic_fetch_add(&(run->next_thread), 1);
+    size_t owned = run->universe / run->threads;
+    uint64_t state = 0x9E3779B97F4A7C15u * (self + 1);
+    size_t found = 0;
+    pthread_barrier_wait(&(run->start));
+
+    for (size_t i = 0; i < run->operations; i++)
+    {
+        uint64_t random = bench_random(&state);
+
+        if ((random % 1000) >= WRITE_PERMILLE)
+        {
+            uint64_t * key = &(run->keys[(random >> 10) % run->universe]);
+
+            if (MUTEX == run->variant)
+            {
+                pthread_mutex_lock(&(run->mutex));
+                found += (search_tree_search(run->tree, key) != NULL);
+                pthread_mutex_unlock(&(run->mutex));
+            }
+            else if (RWLOCK == run->variant)
+            {
+                pthread_rwlock_rdlock(&(run->rwlock));
+                found += (search_tree_search(run->tree, key) != NULL);
+                pthread_rwlock_unlock(&(run->rwlock));
+            }
+            else
+            {
+                found += (search_tree_search(run->tree, key) != NULL);
+            }
+
+            continue;
+        }
+
+        // Toggle one of this thread's keys, so no two threads write the same key
+        size_t idx = self + (run->threads * (size_t)((random >> 10) % owned));
+        bool insert = !run->present[idx];
+        run->present[idx] = insert;
+
+        if (MUTEX == run->variant)
+        {
+            pthread_mutex_lock(&(run->mutex));
+        }
+        else if (RWLOCK == run->variant)
+        {
+            pthread_rwlock_wrlock(&(run->rwlock));
+        }
+
+        if (insert)
+        {
+            search_tree_insert(run->tree, &(run->keys[idx]));
+        }
+        else
+        {
+            search_tree_delete(run->tree, &(run->keys[idx]));
+        }
+
+        if (MUTEX == run->variant)
+        {
+            pthread_mutex_unlock(&(run->mutex));
+        }
+        else if (RWLOCK == run->variant)
+        {
+            pthread_rwlock_unlock(&(run->rwlock));
+        }
+    }
+
+    // Keeps the searches from being optimised away
+    if (found > run->operations)
+    {
+        fputs("Impossible hit count\n", stderr);
+    }
+
+    return NULL;
+}
+
+static int compare_keys(const void * arg1, const void * arg2)
+{
+    // Positive when the first key sorts first, as the tree expects
+    uint64_t key1 = *(const uint64_t *)arg1;
+    uint64_t key2 = *(const uint64_t *)arg2;
+    return (key1 < key2) - (key1 > key2);
+}
+// END OF SOURCE
\ No newline at end of file
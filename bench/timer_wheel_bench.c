@@ -0,0 +1,93 @@
+#include <bench.h>
+#include <timer_wheel.h>
+#include <stdio.h>
+
+// Schedules timers spread over every wheel level and past the wheel's range,
+// cancels most of them the way retransmit and idle timeouts usually go, then
+// advances until the rest have expired.
+// Usage: timer_wheel_bench [timers] [cancel percent] [overflow percent]
+
+static uint64_t pick_deadline(uint64_t * state, size_t overflow_percent);
+static void count_expired(void * data, void * arg);
+
+int main(int argc, char ** argv)
+{
+    size_t timers = bench_arg(argc, argv, 1, 10000000);
+    size_t cancel_percent = bench_arg(argc, argv, 2, 90);
+    size_t overflow_percent = bench_arg(argc, argv, 3, 5);
+
+    timer_wheel_t * wheel = timer_wheel_create(0);
+    wheel_timer_t ** handles = malloc(timers * sizeof(*handles));
+
+    if ((NULL == wheel) || (NULL == handles) || (cancel_percent > 100))
+    {
+        fprintf(stderr, "Could not set up the run\n");
+        return 1;
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    uint64_t latest = 0;
+    uint64_t begin = bench_now();
+    for (size_t i = 0; i < timers; i++)
+    {
+        uint64_t deadline = pick_deadline(&state, overflow_percent);
+        latest = (deadline > latest) ? deadline : latest;
+        handles[i] = timer_wheel_schedule(wheel, deadline, &state);
+    }
+    uint64_t schedule_time = bench_now() - begin;
+
+    // Cancel in random order so removals hit every level and the overflow heap alike
+    size_t cancels = (timers / 100) * cancel_percent + ((timers % 100) * cancel_percent) / 100;
+    for (size_t i = 0; i < cancels; i++)
+    {
+        size_t pick = i + (size_t)(bench_random(&state) % (timers - i));
+        wheel_timer_t * swap = handles[i];
+        handles[i] = handles[pick];
+        handles[pick] = swap;
+    }
+
+    begin = bench_now();
+    for (size_t i = 0; i < cancels; i++)
+    {
+        timer_wheel_cancel(wheel, handles[i]);
+    }
+    uint64_t cancel_time = bench_now() - begin;
+
+    // One advance jumps from event to event, cascading and draining the overflow heap on the way
+    size_t expired = 0;
+    begin = bench_now();
+    size_t fired = timer_wheel_advance(wheel, latest, count_expired, &expired);
+    uint64_t advance_time = bench_now() - begin;
+
+    printf("%zu timers, %zu cancelled, %zu%% beyond the wheel's range\n", timers, cancels, overflow_percent);
+    printf("%12s %14s %12s %12s\n", "phase", "operations", "ms", "Mops");
+    printf("%12s %14zu %12.1f %12.2f\n", "schedule", timers, (double)schedule_time / 1e6, bench_mops(timers, schedule_time));
+    printf("%12s %14zu %12.1f %12.2f\n", "cancel", cancels, (double)cancel_time / 1e6, bench_mops(cancels, cancel_time));
+    printf("%12s %14zu %12.1f %12.2f\n", "advance", fired, (double)advance_time / 1e6, bench_mops(fired, advance_time));
+
+    int result = 0;
+    if ((fired != expired) || (fired != timers - cancels) || (timer_wheel_get_size(wheel) != 0))
+    {
+        fprintf(stderr, "Expected %zu expirations, got %zu\n", timers - cancels, fired);
+        result = 1;
+    }
+
+    free(handles);
+    timer_wheel_destroy(wheel, NULL);
+    return result;
+}
+
+static uint64_t pick_deadline(uint64_t * state, size_t overflow_percent)
+{
+    // Log uniform below 2^32 ticks so each level gets its share, with a slice out to 2^40
+    uint64_t random = bench_random(state);
+    size_t bits = ((random % 100) < overflow_percent) ? 33 + (size_t)((random >> 8) % 8) : 1 + (size_t)((random >> 8) % 32);
+    return (bench_random(state) & ((((uint64_t)1) << bits) - 1)) | 1;
+}
+
+static void count_expired(void * data, void * arg)
+{
+    (void)data;
+    (*(size_t *)arg)++;
+}
+// END OF SOURCE
\ No newline at end of file
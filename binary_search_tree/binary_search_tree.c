@@ -1,9 +1,12 @@
 #include <binary_search_tree.h>
-#include <stack.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 typedef struct node_{
     void * data;
@@ -13,28 +16,120 @@ typedef struct node_{
     struct node_ * parent;
 } node_t;
 
+// Node used with SEARCH_TREE_ORDER_STATS, so plain trees keep the smaller node_t
+typedef struct counted_node_ {
+    node_t node;
+    // Nodes in the subtree rooted here, this one included
+    size_t count;
+} counted_node_t;
+
+#define SLAB_SZ 256
+#define CACHE_LINE_SZ 64
+#define READER_SLOTS 64
+// Removed nodes are reclaimed in batches, each batch costs one grace period
+#define RETIRE_BATCH 64
+// Deeper than any AVL tree can be, a longer walk means a writer moved nodes under the reader
+#define MAX_READ_DEPTH 128
+
+// Publishes a link readers may be following in concurrent mode
+#define STORE_LINK(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+#define LOAD_LINK(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+// Height given to arena nodes sitting on the free list
+#define FREE_NODE UINT32_MAX
+
+// Holds SLAB_SZ nodes of the tree's node_size
+// Epoch a reader entered at, 0 while the slot is free
+typedef struct reader_slot_ {
+    _Alignas(CACHE_LINE_SZ) atomic_uint_fast64_t epoch;
+} reader_slot_t;
+
+typedef struct slab_ {
+    struct slab_ * next;
+    unsigned char nodes[];
+} slab_t;
+
 struct search_tree_ {
     node_t * root;
     size_t size;
     destroy_f destroy;
     compare_f compare;
-    bool node_return_flag;
+    uint32_t flags;
+    size_t node_size;
+    slab_t * slabs;
+    // Free arena nodes are chained through their right pointer
+    node_t * free_nodes;
+    // Only used with SEARCH_TREE_CONCURRENT, odd versions mark a write in progress
+    pthread_mutex_t write_lock;
+    atomic_uint_fast64_t version;
+    atomic_uint_fast64_t epoch;
+    reader_slot_t * readers;
+    // Unlinked nodes waiting out a grace period, chained through their parent pointer
+    node_t * retired;
+    size_t retired_count;
+};
+
+// Spreads threads over the reader slots
+static _Thread_local size_t reader_hint;
+static atomic_size_t next_reader_hint;
+
+struct search_tree_iter_ {
+    search_tree_t * tree;
+    // NULL once the cursor has run off either end
+    node_t * current;
 };
 
 typedef enum child_count_ {NONE, ONE, TWO} child_count_t;
 
 static child_count_t amount_children(node_t * node);
-static void * bst_remove_leaf(search_tree_t * tree, node_t * delete);
-static void * bst_one_child_remove(search_tree_t * tree, node_t * delete);
-static void * bst_two_child_remove(search_tree_t * tree, node_t * delete);
-static int max_height(node_t * node);
+static node_t * bst_remove_leaf(search_tree_t * tree, node_t * delete);
+static node_t * bst_one_child_remove(search_tree_t * tree, node_t * delete);
+static node_t * bst_two_child_remove(search_tree_t * tree, node_t * delete);
+static void replace_child(search_tree_t * tree, node_t * node, node_t * replacement);
+static int node_height(node_t * node);
+static void update_height(node_t * node);
 static int get_balance_factor(node_t * node);
 static void rotate_right(search_tree_t * tree, node_t * parent, node_t * child);
 static void rotate_left(search_tree_t * tree, node_t * parent, node_t * child);
 static void balance_tree(search_tree_t * tree, node_t * start_node);
 static void print_util(node_t * node, int space, print_f printer);
+static node_t * leftmost(node_t * node);
+static node_t * rightmost(node_t * node);
+static node_t * successor(node_t * node);
+static node_t * predecessor(node_t * node);
+static node_t * lower_bound(search_tree_t * tree, void * data);
+static node_t * find_node(search_tree_t * tree, void * data);
+static size_t insert_data(search_tree_t * tree, void * data);
+static void * remove_data(search_tree_t * tree, void * data);
+static int build_sorted(search_tree_t * tree, void ** array, size_t count);
+static int merge_sorted(search_tree_t * tree, void ** array, size_t count);
+static void lock_tree(search_tree_t * tree);
+static void unlock_tree(search_tree_t * tree);
+static void write_begin(search_tree_t * tree);
+static void write_end(search_tree_t * tree);
+static size_t reader_enter(search_tree_t * tree);
+static void reader_exit(search_tree_t * tree, size_t slot);
+static void * optimistic_search(search_tree_t * tree, void * data);
+static node_t * detach_retired(search_tree_t * tree, uint_fast64_t * epoch);
+static void wait_for_readers(search_tree_t * tree, uint_fast64_t epoch);
+static void recycle_retired(search_tree_t * tree, node_t * node);
+static void recycle_node(search_tree_t * tree, node_t * node);
+static int check_sorted(search_tree_t * tree, void ** array, size_t count);
+static int alloc_nodes(search_tree_t * tree, node_t ** nodes, void ** array, size_t count);
+static node_t * allocate_node(search_tree_t * tree);
+static void release_node(search_tree_t * tree, node_t * node);
+static node_t * link_sorted(search_tree_t * tree, node_t ** nodes, size_t count, node_t * parent);
+static node_t * slab_node(search_tree_t * tree, slab_t * slab, size_t index);
+static size_t subtree_count(node_t * node);
+static void update_count(search_tree_t * tree, node_t * node);
+static void adjust_counts(search_tree_t * tree, node_t * node, bool grow);
+static size_t count_below(search_tree_t * tree, void * data, bool inclusive);
 
 search_tree_t * search_tree_create(compare_f compare, destroy_f destroy)
+{
+    return search_tree_create_flags(compare, destroy, 0);
+}
+
+search_tree_t * search_tree_create_flags(compare_f compare, destroy_f destroy, uint32_t flags)
 {
 
     if (compare == NULL)
@@ -49,6 +144,28 @@ search_tree_t * search_tree_create(compare_f compare, destroy_f destroy)
     {
         tree->compare = compare; // Function to compare node data
         tree->destroy = destroy; // Function to destroy node data (Only if needed)
+        tree->flags = flags;
+        tree->node_size = (flags & SEARCH_TREE_ORDER_STATS) ? sizeof(counted_node_t) : sizeof(node_t);
+
+        if (flags & SEARCH_TREE_CONCURRENT)
+        {
+            tree->readers = aligned_alloc(CACHE_LINE_SZ, READER_SLOTS * sizeof(reader_slot_t));
+
+            if (NULL == tree->readers)
+            {
+                free(tree);
+                return NULL;
+            }
+
+            for (size_t i = 0; i < READER_SLOTS; i++)
+            {
+                atomic_init(&(tree->readers[i].epoch), 0);
+            }
+
+            pthread_mutex_init(&(tree->write_lock), NULL);
+            atomic_init(&(tree->version), 0);
+            atomic_init(&(tree->epoch), 1);
+        }
     }
 
     return tree;
@@ -60,65 +177,172 @@ void search_tree_destroy(search_tree_t * tree)
     {
         return;
     }
-    // Free all the memory for each node in the linked list
-    if (tree->root)
+
+    if (tree->flags & SEARCH_TREE_CONCURRENT)
     {
-        node_t * current = tree->root;
-        stack_t * p_stack = stack_create(tree->compare, tree->destroy);
+        // No reader may be left by now, so retired nodes go back without a grace period
+        uint_fast64_t epoch = 0;
+        recycle_retired(tree, detach_retired(tree, &epoch));
+        pthread_mutex_destroy(&(tree->write_lock));
+        free(tree->readers);
+    }
+
+    if (tree->flags & SEARCH_TREE_ARENA)
+    {
+        // Live nodes are found by scanning the slabs, no tree walk needed
+        if (tree->destroy)
+        {
+            for (slab_t * slab = tree->slabs; slab != NULL; slab = slab->next)
+            {
+                for (size_t i = 0; i < SLAB_SZ; i++)
+                {
+                    node_t * node = slab_node(tree, slab, i);
+                    if (node->height != FREE_NODE)
+                    {
+                        tree->destroy(node->data);
+                    }
+                }
+            }
+        }
 
-        while(current)
+        slab_t * slab = tree->slabs;
+        while (slab != NULL)
+        {
+            slab_t * next = slab->next;
+            free(slab);
+            slab = next;
+        }
+    }
+    else
+    {
+        // Free leaves bottom up, climbing back through the parent pointers
+        node_t * current = tree->root;
+        while (current)
         {
             if (current->left)
             {
-                // If I have a left child push myself to the p_stack
-                stack_push(p_stack, current);
-                // Temporary holder for my left child
-                node_t * p_tmp = current->left;
-                // Update current node left pointer to NULL due to freeing of memory for left child
-                current->left = NULL;
-                // Change current node to the left child (temporary holder) to traverse down tree
-                current = p_tmp;
+                current = current->left;
             }
             else if (current->right)
             {
-                // If I have a right child push myself to the p_stack
-                stack_push(p_stack, current);
-                // Temporary holder for my right child
-                node_t * p_tmp = current->right;
-                // Update current node right pointer to NULL due to freeing of memory for right child
-                current->right = NULL;
-                // Change current node to the right child (temporary holder) to traverse down tree
-                current = p_tmp;
+                current = current->right;
             }
             else
             {
-                // Node no longer has any children so free memory for the current node
+                node_t * parent = current->parent;
+                // Detach the leaf so the parent turns into one once both sides are gone
+                if (parent)
+                {
+                    if (parent->left == current)
+                    {
+                        parent->left = NULL;
+                    }
+                    else
+                    {
+                        parent->right = NULL;
+                    }
+                }
+
                 if (tree->destroy)
                 {
                     // Only if destroy function was registered
                     tree->destroy(current->data);
                 }
-                free(current); // Free Node's memory
-                current = stack_pop(p_stack); // Get next node off the p_stack
+                free(current);
+                current = parent;
             }
         }
-        stack_destroy(p_stack); // Destroy the p_stack's memory
-    }   
+    }
 
     free(tree); 
 }
 
 size_t search_tree_insert(search_tree_t * tree, void * data)
+{
+    write_begin(tree);
+    size_t size = insert_data(tree, data);
+    write_end(tree);
+    return size;
+}
+
+void * search_tree_search(search_tree_t * tree, void * data)
+{
+    if ((tree != NULL) && (tree->flags & SEARCH_TREE_CONCURRENT))
+    {
+        return optimistic_search(tree, data);
+    }
+
+    if (tree == NULL || tree->root == NULL || tree->compare == NULL)
+    {
+        // tree must have allocated memory, at least one node, and a compare function to properly remove
+        return NULL;
+    }
+
+    node_t * found = find_node(tree, data);
+    return found ? found->data : NULL;
+}
+
+void * search_tree_delete(search_tree_t * tree, void * data)
+{
+    write_begin(tree);
+    void * return_data = remove_data(tree, data);
+    write_end(tree);
+    return return_data;
+}
+
+void search_tree_synchronize(search_tree_t * tree)
+{
+    if ((NULL == tree) || (0 == (tree->flags & SEARCH_TREE_CONCURRENT)))
+    {
+        return;
+    }
+
+    // The grace period is waited out after unlocking, writers carry on meanwhile
+    uint_fast64_t epoch = 0;
+    lock_tree(tree);
+    node_t * retired = detach_retired(tree, &epoch);
+    unlock_tree(tree);
+    wait_for_readers(tree, epoch);
+    recycle_retired(tree, retired);
+}
+
+size_t search_tree_get_size(search_tree_t * tree)
+{
+    if (NULL == tree)
+    {
+        return 0;
+    }
+
+    lock_tree(tree);
+    size_t size = tree->size;
+    unlock_tree(tree);
+    return size;
+}
+
+size_t search_tree_get_height(search_tree_t * tree)
+{
+    if (NULL == tree)
+    {
+        return 0;
+    }
+
+    lock_tree(tree);
+    size_t height = (size_t)(node_height(tree->root) + 1);
+    unlock_tree(tree);
+    return height;
+}
+
+static size_t insert_data(search_tree_t * tree, void * data)
 {
     // Performs a BST insert then a AVL Reblance in needed
     if (tree == NULL)
     {
         fputs("ERROR: Binary tree pointer is NULL\n", stdout);
+        return 0;
     }
 
     // Perform standard BST insert
-    node_t * new = calloc(sizeof(*new), 1);
-    new->height = 0; // Starting height for a node in the binary search tree
+    node_t * new = allocate_node(tree);
     
     if (!new)
     {
@@ -134,7 +358,7 @@ size_t search_tree_insert(search_tree_t * tree, void * data)
     if (tree->root == NULL)
     {
         // tree is empty insert node at the top of the tree
-        tree->root = new;
+        STORE_LINK(tree->root, new);
     }
     else
     {
@@ -161,6 +385,7 @@ size_t search_tree_insert(search_tree_t * tree, void * data)
             {
                 // The data is the same in both the current node and the new data
                 fputs("Key already exists inside of binary tree.\n", stderr);
+                release_node(tree, new);
                 return tree->size;
             }
         }
@@ -170,105 +395,59 @@ size_t search_tree_insert(search_tree_t * tree, void * data)
             // Add new node to the right of the node who has a NULL right child
             // New node's key is greater than its key
             new->parent = previous_node;
-            previous_node->right = new;
+            STORE_LINK(previous_node->right, new);
         }
         else
         {
             // Add new node to the left of the node who has a NULL left child
             // New node's key is less than its key
             new->parent = previous_node;
-            previous_node->left = new;
+            STORE_LINK(previous_node->left, new);
         }
     }
 
-    //update_heights(new);
-    balance_tree(tree, new);
+    // Counts are brought up to date before any rotation recomputes them from the children
+    adjust_counts(tree, new->parent, true);
+    // Only the new node's ancestors can have changed height
+    balance_tree(tree, new->parent);
     return ++tree->size;
 }
 
-void * search_tree_search(search_tree_t * tree, void * data)
-{
-    if (tree == NULL || tree->root == NULL || tree->compare == NULL)
-    {
-        // tree must have allocated memory, at least one node, and a compare function to properly remove
-        return NULL;
-    }
-
-    node_t * current = tree->root;
-    node_t * p_search = NULL;
-    while (current)
-    {
-        int data_check = tree->compare(data, current->data);
-        if (data_check < 0)
-        {
-            // The search key is larger than the current node's key
-            // Move to the right child of the current node
-            current = current->right;
-        }
-        else if (data_check > 0)
-        {
-            // The search key is smaller than the current node's key
-            // Move to the left child of the current node
-            current = current->left;
-        }
-        else
-        {
-            // Search key found in tree
-            p_search = current;
-            break;
-        }
-    }
-    // If the node was found return the node's data, else return NULL
-    void * return_data = NULL;
-    if (tree->node_return_flag)
-    {
-        return_data = p_search;
-    }
-    else
-    {
-       return_data = p_search ? p_search->data : NULL; 
-    }
-
-    return return_data;
-}
-
-void * search_tree_delete(search_tree_t * tree, void * data)
+static void * remove_data(search_tree_t * tree, void * data)
 {
     if (tree == NULL || tree->root == NULL || tree->compare == NULL)
     {
         // tree must have allocated memory, at least one node, and a compare function to properly remove
         return NULL;
     }
-    tree->node_return_flag = true;
-    node_t * delete_node = search_tree_search(tree, data);
-    tree->node_return_flag = false;
+    node_t * delete_node = find_node(tree, data);
     void * return_data = NULL;
 
     if (delete_node)
     {
         child_count_t children = amount_children(delete_node);
-        node_t * parent_node = delete_node->parent;
+        node_t * rebalance_node = NULL;
+        return_data = delete_node->data;
         
         switch (children)
         {
             case NONE:
-                return_data = bst_remove_leaf(tree, delete_node);
+                rebalance_node = bst_remove_leaf(tree, delete_node);
                 break;
             case ONE:
-                return_data = bst_one_child_remove(tree, delete_node);
+                rebalance_node = bst_one_child_remove(tree, delete_node);
                 break;
             case TWO:
-                return_data = bst_two_child_remove(tree, delete_node);
+                rebalance_node = bst_two_child_remove(tree, delete_node);
                 break;
             default:
                 break;
         }
 
         tree->size--;
-        if (parent_node != NULL)
-        {
-            balance_tree(tree, parent_node);
-        }
+        adjust_counts(tree, rebalance_node, false);
+        // Rebalance from the parent of the node actually unlinked up to the root
+        balance_tree(tree, rebalance_node);
     }
     
     return return_data;
@@ -276,346 +455,1030 @@ void * search_tree_delete(search_tree_t * tree, void * data)
 
 void search_tree_print(search_tree_t * tree, print_f printer)
 {
-    if ((NULL == tree) || (NULL == tree->root))
+    if (NULL == tree)
     {
         return;
     }
-    else
+
+    lock_tree(tree);
+    if (tree->root)
     {
         print_util(tree->root, 0, printer);
     }
+    unlock_tree(tree);
 }
 
-static void print_util(node_t * node, int space, print_f printer)
+int search_tree_build_sorted(search_tree_t * tree, void ** array, size_t count)
 {
-    if (NULL == node)
-    {
-        return;
-    }
-    
-    space += 10;
-
-    print_util(node->right, space, printer);
-
-    printf("\n");
-    for ( int i = 10; i < space; i++)
-    {
-        printf(" ");
-    }
-    printer(node->data);
-    printf(":%d\n", node->height);
+    write_begin(tree);
+    int result = build_sorted(tree, array, count);
+    write_end(tree);
+    return result;
+}
 
-    print_util(node->left, space, printer);
+int search_tree_merge_sorted(search_tree_t * tree, void ** array, size_t count)
+{
+    write_begin(tree);
+    int result = merge_sorted(tree, array, count);
+    write_end(tree);
+    return result;
 }
 
-static child_count_t amount_children(node_t * node)
+static int build_sorted(search_tree_t * tree, void ** array, size_t count)
 {
-    if (node->left == NULL && node->right == NULL)
+    if (NULL == tree)
     {
-        // Leaf node
-        return NONE;
+        return STRUCTURE_NULL;
     }
-    else if ((node->left == NULL) ^ (node->right == NULL))
+    else if ((NULL == array) && (count > 0))
     {
-        // Only one child
-        return ONE;
+        return DATA_NULL;
     }
-    else
+    else if (tree->root != NULL)
     {
-        // Two children
-        return TWO;
+        return STRUCTURE_FULL;
+    }
+    else if (0 == count)
+    {
+        return OK;
     }
-}
 
-static void * bst_remove_leaf(search_tree_t * tree, node_t * delete)
-{
-    if (tree->root == delete)
+    int result = check_sorted(tree, array, count);
+
+    if (result != OK)
     {
-        // The p_node to be deleted is the only p_node in the tree
-        // NULL out the tree root pointer
-        tree->root = NULL;
+        return result;
     }
-    else if (delete == delete->parent->left)
+
+    node_t ** nodes = malloc(count * sizeof(*nodes));
+
+    if (NULL == nodes)
     {
-        delete->parent->left = NULL;
+        return ALLOCATION_ERROR;
     }
-    else
+
+    result = alloc_nodes(tree, nodes, array, count);
+
+    if (OK == result)
     {
-        delete->parent->right = NULL;
+        STORE_LINK(tree->root, link_sorted(tree, nodes, count, NULL));
+        tree->size = count;
     }
 
-    void * p_return_data = delete->data;
-    delete->parent->height = max_height(delete->parent);
-    free(delete);
-    return p_return_data;
+    free(nodes);
+    return result;
 }
 
-static void  * bst_one_child_remove(search_tree_t * tree, node_t * delete)
+static int merge_sorted(search_tree_t * tree, void ** array, size_t count)
 {
-    if (delete->parent == NULL && delete->left)
+    if (NULL == tree)
     {
-        // p_node to be removed is the root p_node in the tree, and p_node has a left child
-        // Remove root p_node and replace with left child
-        tree->root = delete->left;
-        tree->root->parent = NULL;
+        return STRUCTURE_NULL;
     }
-    else if (delete->parent == NULL && delete->right)
+    else if ((NULL == array) && (count > 0))
     {
-        // p_node to be removed is the root p_node in the tree, and p_node has a right child
-        // Remove root p_node and replace with right child
-        tree->root = delete->right;
-        tree->root->parent = NULL;
+        return DATA_NULL;
     }
-    else if (delete->left && delete == delete->parent->left)
+    else if (0 == count)
     {
-        // p_node to be deleted is the left child of the grandparent, p_node replacing me is my left child
-        delete->parent->left = delete->left;
-        delete->left->parent = delete->parent;
+        return OK;
     }
-    else if (delete->right && delete == delete->parent->left)
+
+    int result = check_sorted(tree, array, count);
+
+    if (result != OK)
     {
-        // p_node to be deleted is the left child of the grandparent, p_node replacing me is my right child
-        delete->parent->left = delete->right;
-        delete->right->parent = delete->parent;
+        return result;
     }
-    else if (delete->left && delete == delete->parent->right)
+
+    // Reject the whole batch up front if any key is already in the tree
+    node_t * current = leftmost(tree->root);
+    size_t index = 0;
+    while (current && (index < count))
     {
-        // p_node to be deleted is the right child of the grandparent, p_node replacing me is my left child
-        delete->parent->right = delete->left;
-        delete->left->parent = delete->parent;
+        int data_check = tree->compare(array[index], current->data);
+        if (data_check > 0)
+        {
+            index++;
+        }
+        else if (data_check < 0)
+        {
+            current = successor(current);
+        }
+        else
+        {
+            return KEY_EXISTS;
+        }
     }
-    else
+
+    size_t total = tree->size + count;
+    node_t ** nodes = malloc(total * sizeof(*nodes));
+
+    if (NULL == nodes)
     {
-        // p_node to be deleted is the right child of the grandparent, p_node replacing me is my right child
-        delete->parent->right = delete->right;
-        delete->right->parent = delete->parent;
+        return ALLOCATION_ERROR;
     }
 
-    void * p_return_data = delete->data;
-    delete->parent->height = max_height(delete->parent) + 1;
-    free(delete);
-    return p_return_data;
-}
+    // New nodes sit at the head, merging from the back never overwrites one not yet read
+    result = alloc_nodes(tree, nodes, array, count);
 
-static void * bst_two_child_remove(search_tree_t * tree, node_t * delete)
-{
-    // Find the lowest value in the right of the p_node to be deleted
-    node_t * minimum = delete->right;
-    node_t * current = minimum->left;
-    while(current)
+    if (result != OK)
+    {
+        free(nodes);
+        return result;
+    }
+
+    current = rightmost(tree->root);
+    size_t batch = count;
+    size_t write = total;
+    while (batch > 0)
     {
-        if (tree->compare(minimum->data, current->data) < 0)
+        if (current && (tree->compare(nodes[batch - 1]->data, current->data) > 0))
         {
-            // Found new minimum
-            minimum = current;
+            nodes[--write] = current;
+            current = predecessor(current);
+        }
+        else
+        {
+            nodes[--write] = nodes[batch - 1];
+            batch--;
         }
-
-        current = current->left;
     }
 
-    // Save off data to be removed for return later
-    void * p_return_data = delete->data;
-    // Update the p_node's data to new value. Minimum of the right side of delete p_node
-    delete->data = minimum->data;
-    // See if minimu has any children and remove minimum
-    child_count_t count = amount_children(minimum);
-    switch(count)
+    while (current)
     {
-        case NONE:
-            bst_remove_leaf(tree, minimum);
-            break;
-        case ONE:
-            bst_one_child_remove(tree, minimum);
-            break;
-        case TWO:
-            bst_two_child_remove(tree, minimum);
-        default:
-            break;
+        nodes[--write] = current;
+        current = predecessor(current);
     }
 
-    delete->height = max_height(delete) + 1;
-    return p_return_data;
+    // Existing nodes are relinked in place, so pointers held by callers stay valid
+    STORE_LINK(tree->root, link_sorted(tree, nodes, total, NULL));
+    tree->size = total;
+    free(nodes);
+    return OK;
 }
 
-static int max_height(node_t * node)
+void * search_tree_select(search_tree_t * tree, size_t k)
 {
-    // Get the height of a given node.
-    // Height is the max height between the left and right children
-    int lheight = node->left ? node->left->height : 0;
-    int rheight = node->right ? node->right->height : 0;
-    if(lheight > rheight)
+    if ((NULL == tree) || (0 == (tree->flags & SEARCH_TREE_ORDER_STATS)))
     {
-        return lheight;
+        return NULL;
     }
-    else
+
+    lock_tree(tree);
+    // Skip whole left subtrees by their count instead of walking them
+    node_t * current = (k < tree->size) ? tree->root : NULL;
+    while (current)
     {
-        return rheight;
+        size_t left = subtree_count(current->left);
+        if (k < left)
+        {
+            current = current->left;
+        }
+        else if (k == left)
+        {
+            break;
+        }
+        else
+        {
+            k -= left + 1;
+            current = current->right;
+        }
     }
-}
 
-static int get_balance_factor(node_t * node)
-{
-    // Get the balance factor for a given node needed for AVL trees
-    // abs_switch turns on or off absolute value of the balance factor
-    int lheight = node->left ? node->left->height : 0;
-    int rheight = node->right ? node->right->height : 0;
-    return rheight - lheight;
+    void * found = current ? current->data : NULL;
+    unlock_tree(tree);
+    return found;
 }
 
-static void rotate_right(search_tree_t * tree, node_t * parent, node_t * child)
+ssize_t search_tree_rank(search_tree_t * tree, void * data)
 {
-    // child's right child becomes parents new left child
-    parent->left = child->right;
-    if (parent->left)
+    if ((NULL == tree) || (0 == (tree->flags & SEARCH_TREE_ORDER_STATS)))
     {
-        child->right->parent = parent;
+        return -1;
     }
-    // parent node becomes child node's new right child
-    child->right = parent;
-    // child's parent is now the parent of parent
-    child->parent = parent->parent;
-    // parent's new parent is child
-    parent->parent = child;
 
-    if (child->parent)
+    lock_tree(tree);
+    ssize_t found = -1;
+    size_t rank = 0;
+    node_t * current = tree->root;
+    while (current)
     {
-        // Update the child's new parent pointer to point to child
-        if(tree->compare(child->parent->data, child->data) > 0)
+        int data_check = tree->compare(data, current->data);
+        if (data_check < 0)
+        {
+            // Everything left of here and this node sort before data
+            rank += subtree_count(current->left) + 1;
+            current = current->right;
+        }
+        else if (data_check > 0)
         {
-            // child is larger, therefore on the right side of it's parent
-            child->parent->right = child;
+            current = current->left;
         }
         else
         {
-            // child is smaller, therefore on the left side of it's parent
-            child->parent->left = child;
+            found = (ssize_t)(rank + subtree_count(current->left));
+            break;
         }
     }
 
-    if (tree->root == parent)
+    unlock_tree(tree);
+    return found;
+}
+
+size_t search_tree_count_range(search_tree_t * tree, void * lo, void * hi)
+{
+    if ((NULL == tree) || (0 == (tree->flags & SEARCH_TREE_ORDER_STATS)) || (tree->compare(lo, hi) < 0))
     {
-        // If rotating the root node, then update the pointer to the tree root to be child
-        tree->root = child; 
+        return 0;
     }
-    
-    // Update heights node rotated nodes
-    int tmp_height = parent->height;
-    if ((NULL == parent->left) && (NULL == parent->right))
+
+    lock_tree(tree);
+    size_t count = count_below(tree, hi, true) - count_below(tree, lo, false);
+    unlock_tree(tree);
+    return count;
+}
+
+void search_tree_range(search_tree_t * tree, void * lo, void * hi, visit_f visit, void * arg)
+{
+    if ((NULL == tree) || (NULL == visit))
     {
-        parent->height = 0;
+        return;
     }
-    else
+
+    // Seek to lo, then follow successors until past hi, subtrees outside the range are never entered
+    lock_tree(tree);
+    node_t * current = lower_bound(tree, lo);
+    while (current && (tree->compare(current->data, hi) >= 0))
     {
-        parent->height = child->height - 1;
+        visit(current->data, arg);
+        current = successor(current);
     }
-    
-    child->height = tmp_height - 1;
+    unlock_tree(tree);
 }
 
-static void rotate_left(search_tree_t * tree, node_t * parent, node_t * child)
+search_tree_iter_t * search_tree_iter_create(search_tree_t * tree)
 {
-    // child's left child becomes parent's new right child
-    parent->right = child->left;
-    if (parent->right)
+    if (NULL == tree)
     {
-        // Update node parent pointer to be parent
-        child->left->parent = parent;
+        return NULL;
     }
-    // parent node becomes child node's new left child
-    child->left = parent;
-    // child's parent is now the parent of parent
-    child->parent = parent->parent;
-    // parent's new parent is child
-    parent->parent = child;
-    if (child->parent)
+
+    search_tree_iter_t * iter = calloc(1, sizeof(*iter));
+
+    if (iter != NULL)
     {
-        // Update the child's new parent pointer to point to child
-        if(tree->compare(child->parent->data, child->data) > 0)
-        {
-            // child is larger, therefore on the right side of it's parent
-            child->parent->right = child;
-        }
-        else
+        iter->tree = tree;
+    }
+
+    return iter;
+}
+
+void search_tree_iter_destroy(search_tree_iter_t * iter)
+{
+    free(iter);
+}
+
+void * search_tree_iter_first(search_tree_iter_t * iter)
+{
+    if (NULL == iter)
+    {
+        return NULL;
+    }
+
+    iter->current = leftmost(iter->tree->root);
+    return iter->current ? iter->current->data : NULL;
+}
+
+void * search_tree_iter_last(search_tree_iter_t * iter)
+{
+    if (NULL == iter)
+    {
+        return NULL;
+    }
+
+    iter->current = rightmost(iter->tree->root);
+    return iter->current ? iter->current->data : NULL;
+}
+
+void * search_tree_iter_seek(search_tree_iter_t * iter, void * data)
+{
+    if (NULL == iter)
+    {
+        return NULL;
+    }
+
+    iter->current = lower_bound(iter->tree, data);
+    return iter->current ? iter->current->data : NULL;
+}
+
+void * search_tree_iter_next(search_tree_iter_t * iter)
+{
+    if ((NULL == iter) || (NULL == iter->current))
+    {
+        return NULL;
+    }
+
+    iter->current = successor(iter->current);
+    return iter->current ? iter->current->data : NULL;
+}
+
+void * search_tree_iter_prev(search_tree_iter_t * iter)
+{
+    if ((NULL == iter) || (NULL == iter->current))
+    {
+        return NULL;
+    }
+
+    iter->current = predecessor(iter->current);
+    return iter->current ? iter->current->data : NULL;
+}
+
+static void print_util(node_t * node, int space, print_f printer)
+{
+    if (NULL == node)
+    {
+        return;
+    }
+    
+    space += 10;
+
+    print_util(node->right, space, printer);
+
+    printf("\n");
+    for ( int i = 10; i < space; i++)
+    {
+        printf(" ");
+    }
+    printer(node->data);
+    printf(":%d\n", node->height);
+
+    print_util(node->left, space, printer);
+}
+
+static node_t * leftmost(node_t * node)
+{
+    while (node && node->left)
+    {
+        node = node->left;
+    }
+
+    return node;
+}
+
+static node_t * rightmost(node_t * node)
+{
+    while (node && node->right)
+    {
+        node = node->right;
+    }
+
+    return node;
+}
+
+static node_t * successor(node_t * node)
+{
+    if (node->right)
+    {
+        return leftmost(node->right);
+    }
+
+    // Climb until we come up from a left child, that parent is next in order
+    while (node->parent && (node == node->parent->right))
+    {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
+
+static node_t * predecessor(node_t * node)
+{
+    if (node->left)
+    {
+        return rightmost(node->left);
+    }
+
+    while (node->parent && (node == node->parent->left))
+    {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
+
+static node_t * lower_bound(search_tree_t * tree, void * data)
+{
+    // Keep the last node at or above data while descending towards it
+    node_t * current = tree->root;
+    node_t * bound = NULL;
+    while (current)
+    {
+        if (tree->compare(data, current->data) >= 0)
+        {
+            bound = current;
+            current = current->left;
+        }
+        else
+        {
+            current = current->right;
+        }
+    }
+
+    return bound;
+}
+
+static node_t * find_node(search_tree_t * tree, void * data)
+{
+    node_t * current = tree->root;
+    while (current)
+    {
+        int data_check = tree->compare(data, current->data);
+        if (data_check < 0)
         {
-            // child is smaller, therefore on the left side of it's parent
-            child->parent->left = child;
+            // The search key is larger than the current node's key
+            // Move to the right child of the current node
+            current = current->right;
+        }
+        else if (data_check > 0)
+        {
+            // The search key is smaller than the current node's key
+            // Move to the left child of the current node
+            current = current->left;
+        }
+        else
+        {
+            // Search key found in tree
+            break;
         }
     }
-    if (tree->root == parent)
+
+    return current;
+}
+
+static void lock_tree(search_tree_t * tree)
+{
+    if ((tree != NULL) && (tree->flags & SEARCH_TREE_CONCURRENT))
     {
-        // If rotating the root node, then update the pointer to the tree root to be child
-        tree->root = child; 
+        pthread_mutex_lock(&(tree->write_lock));
     }
-    
-    // Update heights node rotated nodes
-    int tmp_height = parent->height;
-    if ((NULL == parent->left) && (NULL == parent->right))
+}
+
+static void unlock_tree(search_tree_t * tree)
+{
+    if ((tree != NULL) && (tree->flags & SEARCH_TREE_CONCURRENT))
     {
-        parent->height = 0;
+        pthread_mutex_unlock(&(tree->write_lock));
     }
-    else
+}
+
+static void write_begin(search_tree_t * tree)
+{
+    if ((tree != NULL) && (tree->flags & SEARCH_TREE_CONCURRENT))
     {
-        parent->height = child->height - 1;
+        pthread_mutex_lock(&(tree->write_lock));
+        // Readers overlapping an odd version retry, the fence keeps the bump ahead of the changes
+        uint_fast64_t version = atomic_load_explicit(&(tree->version), memory_order_relaxed);
+        atomic_store_explicit(&(tree->version), version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
     }
-    
-    child->height = tmp_height - 1;
 }
 
-static void balance_tree(search_tree_t * tree, node_t * start_node)
+static void write_end(search_tree_t * tree)
 {
-    node_t * current = start_node;
-    int bf = 0;
+    if ((tree != NULL) && (tree->flags & SEARCH_TREE_CONCURRENT))
+    {
+        uint_fast64_t version = atomic_load_explicit(&(tree->version), memory_order_relaxed);
+        atomic_store_explicit(&(tree->version), version + 1, memory_order_release);
 
-    // Travel upwards and Check balance factors
-    while(current->parent && (bf <= 1 && bf >= -1))
+        // A full batch is taken out under the lock, but its grace period is waited
+        // out after unlocking so a slow reader holds up only this writer
+        uint_fast64_t epoch = 0;
+        node_t * retired = (tree->retired_count >= RETIRE_BATCH) ? detach_retired(tree, &epoch) : NULL;
+        pthread_mutex_unlock(&(tree->write_lock));
+
+        if (retired != NULL)
+        {
+            wait_for_readers(tree, epoch);
+            recycle_retired(tree, retired);
+        }
+    }
+}
+
+static size_t reader_enter(search_tree_t * tree)
+{
+    // Each thread starts at its own slot so readers rarely share a cache line
+    if (0 == reader_hint)
     {
-        current = current->parent;
-        bf = get_balance_factor(current); // Get the balance factor of the node
-        current->height = max_height(current) + 1; // Update the node's height to the left/right subtree max height plus one
+        reader_hint = atomic_fetch_add(&next_reader_hint, 1) + 1;
+    }
+
+    size_t slot = reader_hint % READER_SLOTS;
+    for (;;)
+    {
+        uint_fast64_t idle = 0;
+        uint_fast64_t epoch = atomic_load(&(tree->epoch));
+        if (atomic_compare_exchange_weak(&(tree->readers[slot].epoch), &idle, epoch))
+        {
+            break;
+        }
+
+        slot = (slot + 1) % READER_SLOTS;
+    }
+
+    // Pairs with the fence in detach_retired, either the writer sees this slot
+    // or this reader sees the tree without the nodes being reclaimed
+    atomic_thread_fence(memory_order_seq_cst);
+    return slot;
+}
+
+static void reader_exit(search_tree_t * tree, size_t slot)
+{
+    atomic_store_explicit(&(tree->readers[slot].epoch), 0, memory_order_release);
+}
+
+static void * optimistic_search(search_tree_t * tree, void * data)
+{
+    // The reader slot is given up between attempts, a reader held back by writers
+    // must not also hold back the grace periods those writers wait on
+    size_t slot = 0;
+    void * found = NULL;
+    for (;;)
+    {
+        slot = reader_enter(tree);
+        uint_fast64_t version = atomic_load_explicit(&(tree->version), memory_order_acquire);
+
+        if (version & 1)
+        {
+            // A write is in progress, searches block until it ends rather than walk the change
+            reader_exit(tree, slot);
+            sched_yield();
+            continue;
+        }
+
+        // Nodes seen here may be mid rotation, the version check afterwards throws such walks away
+        bool complete = false;
+        found = NULL;
+        node_t * current = LOAD_LINK(tree->root);
+        for (size_t depth = 0; depth < MAX_READ_DEPTH; depth++)
+        {
+            if (NULL == current)
+            {
+                complete = true;
+                break;
+            }
+
+            void * node_data = LOAD_LINK(current->data);
+            int data_check = tree->compare(data, node_data);
+            if (data_check < 0)
+            {
+                current = LOAD_LINK(current->right);
+            }
+            else if (data_check > 0)
+            {
+                current = LOAD_LINK(current->left);
+            }
+            else
+            {
+                found = node_data;
+                complete = true;
+                break;
+            }
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (complete && (atomic_load_explicit(&(tree->version), memory_order_relaxed) == version))
+        {
+            break;
+        }
+
+        reader_exit(tree, slot);
+    }
+
+    reader_exit(tree, slot);
+    return found;
+}
+
+static node_t * detach_retired(search_tree_t * tree, uint_fast64_t * epoch)
+{
+    // Called with the writer lock held. Readers that entered before the epoch bump
+    // may still hold the detached nodes, later readers can no longer reach them.
+    atomic_thread_fence(memory_order_seq_cst);
+    *epoch = atomic_fetch_add(&(tree->epoch), 1) + 1;
+
+    node_t * retired = tree->retired;
+    tree->retired = NULL;
+    tree->retired_count = 0;
+    return retired;
+}
+
+static void wait_for_readers(search_tree_t * tree, uint_fast64_t epoch)
+{
+    for (size_t i = 0; i < READER_SLOTS; i++)
+    {
+        uint_fast64_t seen = atomic_load(&(tree->readers[i].epoch));
+        while ((seen != 0) && (seen < epoch))
+        {
+            sched_yield();
+            seen = atomic_load(&(tree->readers[i].epoch));
+        }
+    }
+}
+
+static void recycle_retired(search_tree_t * tree, node_t * node)
+{
+    // Arena nodes go back on the shared free list, which needs the writer lock
+    bool arena = (tree->flags & SEARCH_TREE_ARENA) && (node != NULL);
+    if (arena)
+    {
+        pthread_mutex_lock(&(tree->write_lock));
+    }
+
+    while (node)
+    {
+        node_t * next = node->parent;
+        recycle_node(tree, node);
+        node = next;
     }
 
-    if (bf >= -1 && bf <= 1)
+    if (arena)
+    {
+        pthread_mutex_unlock(&(tree->write_lock));
+    }
+}
+
+static int check_sorted(search_tree_t * tree, void ** array, size_t count)
+{
+    for (size_t i = 1; i < count; i++)
     {
+        int data_check = tree->compare(array[i - 1], array[i]);
+        if (0 == data_check)
+        {
+            return KEY_EXISTS;
+        }
+        else if (data_check < 0)
+        {
+            return DATA_ERROR;
+        }
+    }
+
+    return OK;
+}
+
+static int alloc_nodes(search_tree_t * tree, node_t ** nodes, void ** array, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes[i] = allocate_node(tree);
+
+        if (NULL == nodes[i])
+        {
+            while (i > 0)
+            {
+                release_node(tree, nodes[--i]);
+            }
+            return ALLOCATION_ERROR;
+        }
+
+        nodes[i]->data = array[i];
+    }
+
+    return OK;
+}
+
+static node_t * link_sorted(search_tree_t * tree, node_t ** nodes, size_t count, node_t * parent)
+{
+    if (0 == count)
+    {
+        return NULL;
+    }
+
+    // The middle node becomes the subtree root, so the sides differ in size by at most one
+    size_t middle = count / 2;
+    node_t * node = nodes[middle];
+    node->parent = parent;
+    STORE_LINK(node->left, link_sorted(tree, nodes, middle, node));
+    STORE_LINK(node->right, link_sorted(tree, nodes + middle + 1, count - middle - 1, node));
+    update_height(node);
+    update_count(tree, node);
+    return node;
+}
+
+static node_t * allocate_node(search_tree_t * tree)
+{
+    node_t * node = NULL;
+    if (0 == (tree->flags & SEARCH_TREE_ARENA))
+    {
+        node = calloc(1, tree->node_size);
+
+        if (node && (tree->flags & SEARCH_TREE_ORDER_STATS))
+        {
+            ((counted_node_t *)node)->count = 1;
+        }
+
+        return node;
+    }
+
+    if (NULL == tree->free_nodes)
+    {
+        slab_t * slab = malloc(sizeof(*slab) + (SLAB_SZ * tree->node_size));
+
+        if (NULL == slab)
+        {
+            return NULL;
+        }
+
+        slab->next = tree->slabs;
+        tree->slabs = slab;
+
+        // Push in reverse so consecutive inserts take neighbouring nodes
+        for (size_t i = SLAB_SZ; i > 0; i--)
+        {
+            recycle_node(tree, slab_node(tree, slab, i - 1));
+        }
+    }
+
+    node = tree->free_nodes;
+    tree->free_nodes = node->right;
+    memset(node, 0, tree->node_size);
+
+    if (tree->flags & SEARCH_TREE_ORDER_STATS)
+    {
+        ((counted_node_t *)node)->count = 1;
+    }
+
+    return node;
+}
+
+static void release_node(search_tree_t * tree, node_t * node)
+{
+    if (tree->flags & SEARCH_TREE_CONCURRENT)
+    {
+        // A reader may still be on the node, its links stay intact until the grace period ends
+        node->parent = tree->retired;
+        tree->retired = node;
+        tree->retired_count++;
         return;
     }
 
-    
-    // Find the correct child node with is in the path to the new node that was inserted
-    if (bf <= -1)
+    recycle_node(tree, node);
+}
+
+static void recycle_node(search_tree_t * tree, node_t * node)
+{
+    if (0 == (tree->flags & SEARCH_TREE_ARENA))
+    {
+        free(node);
+        return;
+    }
+
+    node->height = FREE_NODE;
+    node->right = tree->free_nodes;
+    tree->free_nodes = node;
+}
+
+static node_t * slab_node(search_tree_t * tree, slab_t * slab, size_t index)
+{
+    return (node_t *)(slab->nodes + (index * tree->node_size));
+}
+
+static size_t subtree_count(node_t * node)
+{
+    return node ? ((counted_node_t *)node)->count : 0;
+}
+
+static void update_count(search_tree_t * tree, node_t * node)
+{
+    if (tree->flags & SEARCH_TREE_ORDER_STATS)
+    {
+        ((counted_node_t *)node)->count = subtree_count(node->left) + subtree_count(node->right) + 1;
+    }
+}
+
+static void adjust_counts(search_tree_t * tree, node_t * node, bool grow)
+{
+    if (0 == (tree->flags & SEARCH_TREE_ORDER_STATS))
+    {
+        return;
+    }
+
+    // Every ancestor of the node added or removed gains or loses one
+    for (; node != NULL; node = node->parent)
     {
-        // left subtree is unbalanced
-        if (tree->compare(start_node->data, current->left->data) > 0)
+        if (grow)
         {
-            // Grandchild is the left child of node_t * child
-            // Perform right rotate
-            rotate_right(tree, current, current->left);
+            ((counted_node_t *)node)->count++;
         }
         else
         {
-            // Grandchild is the right child of node_t * child
-            // Perform left right Rotate
-            rotate_left(tree, current->left, current->left->right);
-            rotate_right(tree, current, current->left);
+            ((counted_node_t *)node)->count--;
         }
     }
-    else
+}
+
+static size_t count_below(search_tree_t * tree, void * data, bool inclusive)
+{
+    // Number of elements before data, or up to and including it
+    size_t count = 0;
+    node_t * current = tree->root;
+    while (current)
     {
-        // right subtree is unbalanced
-        if (tree->compare(start_node->data, current->right->data) < 0)
+        int data_check = tree->compare(data, current->data);
+        if ((data_check < 0) || (inclusive && (0 == data_check)))
         {
-            // Grandchild is the right child of node_t * child
-            // Perform left Rotate
-            rotate_left(tree, current, current->right);
+            count += subtree_count(current->left) + 1;
+            current = current->right;
         }
         else
         {
-            // Grandchild is the left child of node_t * child
-            // Perform right left Rotate
-            rotate_right(tree, current->right, current->right->left);
-            rotate_left(tree, current, current->right);
+            current = current->left;
         }
     }
 
-    return;
+    return count;
+}
+
+static child_count_t amount_children(node_t * node)
+{
+    if (node->left == NULL && node->right == NULL)
+    {
+        // Leaf node
+        return NONE;
+    }
+    else if ((node->left == NULL) ^ (node->right == NULL))
+    {
+        // Only one child
+        return ONE;
+    }
+    else
+    {
+        // Two children
+        return TWO;
+    }
+}
+
+static node_t * bst_remove_leaf(search_tree_t * tree, node_t * delete)
+{
+    // Unlink the leaf from its parent, or empty the tree if it was the root
+    node_t * parent = delete->parent;
+    replace_child(tree, delete, NULL);
+    release_node(tree, delete);
+    return parent;
+}
+
+static node_t * bst_one_child_remove(search_tree_t * tree, node_t * delete)
+{
+    // The only child takes the deleted node's place under its parent
+    node_t * parent = delete->parent;
+    replace_child(tree, delete, (delete->left != NULL) ? delete->left : delete->right);
+    release_node(tree, delete);
+    return parent;
+}
+
+static node_t * bst_two_child_remove(search_tree_t * tree, node_t * delete)
+{
+    // The in-order successor is the leftmost node of the right subtree
+    node_t * minimum = delete->right;
+    while (minimum->left)
+    {
+        minimum = minimum->left;
+    }
+
+    // Move the successor's data up and remove the successor, which has no left child
+    STORE_LINK(delete->data, minimum->data);
+
+    if (minimum->right)
+    {
+        return bst_one_child_remove(tree, minimum);
+    }
+
+    return bst_remove_leaf(tree, minimum);
+}
+
+static void replace_child(search_tree_t * tree, node_t * node, node_t * replacement)
+{
+    // Point whatever referenced node at replacement instead
+    if (NULL == node->parent)
+    {
+        STORE_LINK(tree->root, replacement);
+    }
+    else if (node == node->parent->left)
+    {
+        STORE_LINK(node->parent->left, replacement);
+    }
+    else
+    {
+        STORE_LINK(node->parent->right, replacement);
+    }
+
+    if (replacement)
+    {
+        replacement->parent = node->parent;
+    }
+}
+
+static int node_height(node_t * node)
+{
+    // Leaves have height 0, so an empty subtree counts as -1
+    return node ? (int)node->height : -1;
+}
+
+static void update_height(node_t * node)
+{
+    int lheight = node_height(node->left);
+    int rheight = node_height(node->right);
+    node->height = (uint32_t)(((lheight > rheight) ? lheight : rheight) + 1);
+}
+
+static int get_balance_factor(node_t * node)
+{
+    // Get the balance factor for a given node needed for AVL trees
+    return node_height(node->right) - node_height(node->left);
+}
+
+static void rotate_right(search_tree_t * tree, node_t * parent, node_t * child)
+{
+    // child's right child becomes parents new left child
+    STORE_LINK(parent->left, child->right);
+    if (parent->left)
+    {
+        child->right->parent = parent;
+    }
+    // child takes parent's place under the grandparent, or as the root
+    replace_child(tree, parent, child);
+    // parent node becomes child node's new right child
+    STORE_LINK(child->right, parent);
+    parent->parent = child;
+
+    // parent is now below child, so its height is fixed first
+    update_height(parent);
+    update_height(child);
+    update_count(tree, parent);
+    update_count(tree, child);
+}
+
+static void rotate_left(search_tree_t * tree, node_t * parent, node_t * child)
+{
+    // child's left child becomes parent's new right child
+    STORE_LINK(parent->right, child->left);
+    if (parent->right)
+    {
+        child->left->parent = parent;
+    }
+    // child takes parent's place under the grandparent, or as the root
+    replace_child(tree, parent, child);
+    // parent node becomes child node's new left child
+    STORE_LINK(child->left, parent);
+    parent->parent = child;
+
+    // parent is now below child, so its height is fixed first
+    update_height(parent);
+    update_height(child);
+    update_count(tree, parent);
+    update_count(tree, child);
+}
+
+static void balance_tree(search_tree_t * tree, node_t * start_node)
+{
+    // Walk up from the lowest node whose subtree changed, fixing heights and
+    // rotating where unbalanced. Once a subtree's height is unchanged nothing
+    // above it can have changed either.
+    node_t * current = start_node;
+    while (current)
+    {
+        int old_height = (int)current->height;
+        update_height(current);
+        int bf = get_balance_factor(current);
+
+        if (bf < -1)
+        {
+            // left subtree is too tall, a right heavy left child needs a left right rotate
+            if (get_balance_factor(current->left) > 0)
+            {
+                rotate_left(tree, current->left, current->left->right);
+            }
+
+            rotate_right(tree, current, current->left);
+            current = current->parent;
+        }
+        else if (bf > 1)
+        {
+            // right subtree is too tall, a left heavy right child needs a right left rotate
+            if (get_balance_factor(current->right) < 0)
+            {
+                rotate_right(tree, current->right, current->right->left);
+            }
+
+            rotate_left(tree, current, current->right);
+            current = current->parent;
+        }
+
+        if ((int)current->height == old_height)
+        {
+            break;
+        }
+
+        current = current->parent;
+    }
 }
 // END OF SOURCE
\ No newline at end of file
@@ -2,15 +2,52 @@
 #define _BINARY_SEARCH_TREE_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include <dstruct_funcs.h>
 
+// Nodes are carved out of slabs, freed together when the tree is destroyed
+#define SEARCH_TREE_ARENA 0x1
+// Nodes also count their subtree, enabling select, rank and count_range
+#define SEARCH_TREE_ORDER_STATS 0x2
+// search_tree_search is optimistic, it takes no lock but blocks while a write is in progress
+// and retries walks a write overlapped. Everything else takes the writer lock.
+// Iterators are not safe here. Removed data may still be read until search_tree_synchronize returns.
+#define SEARCH_TREE_CONCURRENT 0x4
+
 typedef struct search_tree_ search_tree_t;
+// In-order cursor, invalidated by any insert or delete on its tree
+typedef struct search_tree_iter_ search_tree_iter_t;
 
 search_tree_t * search_tree_create(compare_f compare, destroy_f destroy);
+search_tree_t * search_tree_create_flags(compare_f compare, destroy_f destroy, uint32_t flags);
 void search_tree_destroy(search_tree_t * tree);
 size_t search_tree_insert(search_tree_t * p_tree, void * p_data);
 void * search_tree_search(search_tree_t * p_tree, void * p_data);
 void * search_tree_delete(search_tree_t * p_tree, void * p_data);
 void search_tree_print(search_tree_t * tree, print_f printer);
+size_t search_tree_get_size(search_tree_t * tree);
+// Nodes on the longest root to leaf path, 0 for an empty tree
+size_t search_tree_get_height(search_tree_t * tree);
+// Waits until no reader can still see data removed so far, after which it may be freed
+void search_tree_synchronize(search_tree_t * tree);
+// Array must be strictly increasing, build needs an empty tree, merge costs O(n + count)
+int search_tree_build_sorted(search_tree_t * tree, void ** array, size_t count);
+int search_tree_merge_sorted(search_tree_t * tree, void ** array, size_t count);
+// Positions count from 0 in order, these need SEARCH_TREE_ORDER_STATS
+void * search_tree_select(search_tree_t * tree, size_t k);
+ssize_t search_tree_rank(search_tree_t * tree, void * data);
+size_t search_tree_count_range(search_tree_t * tree, void * lo, void * hi);
+// Visits every element from lo to hi inclusive in order
+void search_tree_range(search_tree_t * tree, void * lo, void * hi, visit_f visit, void * arg);
+
+search_tree_iter_t * search_tree_iter_create(search_tree_t * tree);
+void search_tree_iter_destroy(search_tree_iter_t * iter);
+void * search_tree_iter_first(search_tree_iter_t * iter);
+void * search_tree_iter_last(search_tree_iter_t * iter);
+// Moves to the first element not below data
+void * search_tree_iter_seek(search_tree_iter_t * iter, void * data);
+void * search_tree_iter_next(search_tree_iter_t * iter);
+void * search_tree_iter_prev(search_tree_iter_t * iter);
 
 #endif
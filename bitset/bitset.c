@@ -0,0 +1,331 @@
+#include <bitset.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITSET_X86
+#endif
+
+// Words are 32 byte aligned and padded to a multiple of four so the vector loops have no tail
+#define VECTOR_SZ 32
+#define VECTOR_WORDS (VECTOR_SZ / sizeof(uint64_t))
+
+typedef enum {BIT_OR, BIT_AND, BIT_ANDNOT} bit_op_t;
+
+struct bitset
+{
+    uint64_t * words;
+    size_t word_count;
+    size_t bits;
+};
+
+static bitset_path_t forced_path = BITSET_PATH_AUTO;
+
+static int combine(bitset_t * bitset, bitset_t * other, bit_op_t op);
+static bool path_supported(bitset_path_t path);
+static void combine_scalar(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op);
+#ifdef BITSET_X86
+static void combine_sse2(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op);
+static void combine_avx2(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op);
+#endif
+
+bitset_t * bitset_create(size_t bits)
+{
+    if (0 == bits)
+    {
+        return NULL;
+    }
+
+    bitset_t * bitset = calloc(1, sizeof(*bitset));
+
+    if (bitset != NULL)
+    {
+        bitset->bits = bits;
+        bitset->word_count = (((bits + 63) / 64) + VECTOR_WORDS - 1) & ~(VECTOR_WORDS - 1);
+        bitset->words = aligned_alloc(VECTOR_SZ, bitset->word_count * sizeof(uint64_t));
+
+        if (NULL == bitset->words)
+        {
+            free(bitset);
+            return NULL;
+        }
+
+        memset(bitset->words, 0, bitset->word_count * sizeof(uint64_t));
+    }
+
+    return bitset;
+}
+
+void bitset_destroy(bitset_t * bitset)
+{
+    if (bitset != NULL)
+    {
+        free(bitset->words);
+        free(bitset);
+    }
+}
+
+int bitset_set(bitset_t * bitset, size_t bit)
+{
+    if (NULL == bitset)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (bit >= bitset->bits)
+    {
+        return KEY_ERROR;
+    }
+
+    bitset->words[bit / 64] |= (uint64_t)1 << (bit % 64);
+    return OK;
+}
+
+int bitset_clear(bitset_t * bitset, size_t bit)
+{
+    if (NULL == bitset)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (bit >= bitset->bits)
+    {
+        return KEY_ERROR;
+    }
+
+    bitset->words[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+    return OK;
+}
+
+bool bitset_test(bitset_t * bitset, size_t bit)
+{
+    if ((NULL == bitset) || (bit >= bitset->bits))
+    {
+        return false;
+    }
+
+    return (bitset->words[bit / 64] >> (bit % 64)) & 1;
+}
+
+void bitset_clear_all(bitset_t * bitset)
+{
+    if (bitset != NULL)
+    {
+        memset(bitset->words, 0, bitset->word_count * sizeof(uint64_t));
+    }
+}
+
+size_t bitset_count(bitset_t * bitset)
+{
+    if (NULL == bitset)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < bitset->word_count; i++)
+    {
+        count += (size_t)__builtin_popcountll(bitset->words[i]);
+    }
+
+    return count;
+}
+
+ssize_t bitset_find_next(bitset_t * bitset, size_t bit)
+{
+    if ((NULL == bitset) || (bit >= bitset->bits))
+    {
+        return -1;
+    }
+
+    // Mask off the bits below the start in the first word, then skip empty words
+    size_t word = bit / 64;
+    uint64_t current = bitset->words[word] & (~(uint64_t)0 << (bit % 64));
+    while (0 == current)
+    {
+        word++;
+
+        if (word == bitset->word_count)
+        {
+            return -1;
+        }
+
+        current = bitset->words[word];
+    }
+
+    // Padding bits are never set, so any bit found is in range
+    return (ssize_t)((word * 64) + (size_t)__builtin_ctzll(current));
+}
+
+int bitset_union(bitset_t * bitset, bitset_t * other)
+{
+    return combine(bitset, other, BIT_OR);
+}
+
+int bitset_intersect(bitset_t * bitset, bitset_t * other)
+{
+    return combine(bitset, other, BIT_AND);
+}
+
+int bitset_difference(bitset_t * bitset, bitset_t * other)
+{
+    return combine(bitset, other, BIT_ANDNOT);
+}
+
+size_t bitset_get_size(bitset_t * bitset)
+{
+    return (bitset != NULL) ? bitset->bits : 0;
+}
+
+int bitset_force_path(bitset_path_t path)
+{
+    if ((path != BITSET_PATH_AUTO) && !path_supported(path))
+    {
+        return DATA_ERROR;
+    }
+
+    forced_path = path;
+    return OK;
+}
+
+static int combine(bitset_t * bitset, bitset_t * other, bit_op_t op)
+{
+    if ((NULL == bitset) || (NULL == other))
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (bitset->bits != other->bits)
+    {
+        return DATA_ERROR;
+    }
+
+    // Pick the widest vector unit the CPU running us has, unless a path was forced
+    bitset_path_t path = forced_path;
+    if (BITSET_PATH_AUTO == path)
+    {
+        path = path_supported(BITSET_PATH_AVX2) ? BITSET_PATH_AVX2 :
+               path_supported(BITSET_PATH_SSE2) ? BITSET_PATH_SSE2 : BITSET_PATH_SCALAR;
+    }
+
+    switch (path)
+    {
+#ifdef BITSET_X86
+        case BITSET_PATH_AVX2:
+            combine_avx2(bitset->words, other->words, bitset->word_count, op);
+            break;
+        case BITSET_PATH_SSE2:
+            combine_sse2(bitset->words, other->words, bitset->word_count, op);
+            break;
+#endif
+        default:
+            combine_scalar(bitset->words, other->words, bitset->word_count, op);
+            break;
+    }
+
+    return OK;
+}
+
+static bool path_supported(bitset_path_t path)
+{
+    switch (path)
+    {
+        case BITSET_PATH_SCALAR:
+            return true;
+#ifdef BITSET_X86
+        case BITSET_PATH_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case BITSET_PATH_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static void combine_scalar(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op)
+{
+    switch (op)
+    {
+        case BIT_OR:
+            for (size_t i = 0; i < words; i++)
+            {
+                dst[i] |= src[i];
+            }
+            break;
+        case BIT_AND:
+            for (size_t i = 0; i < words; i++)
+            {
+                dst[i] &= src[i];
+            }
+            break;
+        case BIT_ANDNOT:
+            for (size_t i = 0; i < words; i++)
+            {
+                dst[i] &= ~src[i];
+            }
+            break;
+    }
+}
+
+#ifdef BITSET_X86
+__attribute__((target("sse2")))
+static void combine_sse2(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op)
+{
+    __m128i * dst_vector = (__m128i *)dst;
+    const __m128i * src_vector = (const __m128i *)src;
+    size_t count = words / 2;
+    switch (op)
+    {
+        case BIT_OR:
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm_store_si128(&dst_vector[i], _mm_or_si128(_mm_load_si128(&dst_vector[i]), _mm_load_si128(&src_vector[i])));
+            }
+            break;
+        case BIT_AND:
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm_store_si128(&dst_vector[i], _mm_and_si128(_mm_load_si128(&dst_vector[i]), _mm_load_si128(&src_vector[i])));
+            }
+            break;
+        case BIT_ANDNOT:
+            // andnot negates its first operand
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm_store_si128(&dst_vector[i], _mm_andnot_si128(_mm_load_si128(&src_vector[i]), _mm_load_si128(&dst_vector[i])));
+            }
+            break;
+    }
+}
+
+__attribute__((target("avx2")))
+static void combine_avx2(uint64_t * dst, const uint64_t * src, size_t words, bit_op_t op)
+{
+    __m256i * dst_vector = (__m256i *)dst;
+    const __m256i * src_vector = (const __m256i *)src;
+    size_t count = words / 4;
+    switch (op)
+    {
+        case BIT_OR:
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm256_store_si256(&dst_vector[i], _mm256_or_si256(_mm256_load_si256(&dst_vector[i]), _mm256_load_si256(&src_vector[i])));
+            }
+            break;
+        case BIT_AND:
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm256_store_si256(&dst_vector[i], _mm256_and_si256(_mm256_load_si256(&dst_vector[i]), _mm256_load_si256(&src_vector[i])));
+            }
+            break;
+        case BIT_ANDNOT:
+            // andnot negates its first operand
+            for (size_t i = 0; i < count; i++)
+            {
+                _mm256_store_si256(&dst_vector[i], _mm256_andnot_si256(_mm256_load_si256(&src_vector[i]), _mm256_load_si256(&dst_vector[i])));
+            }
+            break;
+    }
+}
+#endif
+// END OF SOURCE
\ No newline at end of file
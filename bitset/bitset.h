@@ -0,0 +1,31 @@
+#ifndef _BITSET_H_
+#define _BITSET_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <dstruct_funcs.h>
+
+// Fixed size set of the integers 0 to bits - 1, one bit each.
+// Union, intersect and difference work in place and need bitsets of equal size.
+typedef struct bitset bitset_t;
+
+// Loops behind union, intersect and difference, AUTO uses the widest one the CPU has.
+// Forcing a path is process wide and meant for benchmarks and for checking the paths agree.
+typedef enum {BITSET_PATH_AUTO, BITSET_PATH_SCALAR, BITSET_PATH_SSE2, BITSET_PATH_AVX2} bitset_path_t;
+
+bitset_t * bitset_create(size_t bits);
+void bitset_destroy(bitset_t * bitset);
+int bitset_set(bitset_t * bitset, size_t bit);
+int bitset_clear(bitset_t * bitset, size_t bit);
+bool bitset_test(bitset_t * bitset, size_t bit);
+void bitset_clear_all(bitset_t * bitset);
+size_t bitset_count(bitset_t * bitset);
+ssize_t bitset_find_next(bitset_t * bitset, size_t bit);
+int bitset_union(bitset_t * bitset, bitset_t * other);
+int bitset_intersect(bitset_t * bitset, bitset_t * other);
+int bitset_difference(bitset_t * bitset, bitset_t * other);
+size_t bitset_get_size(bitset_t * bitset);
+int bitset_force_path(bitset_path_t path);
+
+#endif
\ No newline at end of file
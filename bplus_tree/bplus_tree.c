@@ -0,0 +1,642 @@
+#include <bplus_tree.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 32 keys puts an inner node at 528 bytes, so a level is a few adjacent cache lines
+// instead of one miss per key as in search_tree_t
+#define BPLUS_ORDER 32
+// Every node but the root keeps this many keys, two minimal nodes and a separator fit in one
+#define BPLUS_MIN ((BPLUS_ORDER - 1) / 2)
+#define CACHE_LINE 64
+
+typedef struct bplus_node
+{
+    uint32_t count;
+    bool leaf;
+    void * keys[BPLUS_ORDER];
+} bplus_node_t;
+
+// Leaves and inner nodes start with the common node so either can be handled through it
+typedef struct bplus_leaf
+{
+    bplus_node_t node;
+    struct bplus_leaf * next;
+} bplus_leaf_t;
+
+typedef struct bplus_inner
+{
+    bplus_node_t node;
+    // Separator i is the smallest key under child i + 1
+    bplus_node_t * children[BPLUS_ORDER + 1];
+} bplus_inner_t;
+
+struct bplus_tree
+{
+    bplus_node_t * root;
+    size_t size;
+    compare_f compare;
+    destroy_f destroy;
+};
+
+static bplus_node_t * create_node(bool leaf);
+static void free_subtree(bplus_tree_t * tree, bplus_node_t * node, bool destroy_data);
+static void free_level(bplus_tree_t * tree, bplus_node_t ** level, size_t start, size_t end);
+static uint32_t lower_bound(bplus_tree_t * tree, bplus_node_t * node, void * data);
+static uint32_t upper_bound(bplus_tree_t * tree, bplus_node_t * node, void * data);
+static bplus_leaf_t * find_leaf(bplus_tree_t * tree, void * data);
+static void * subtree_min(bplus_node_t * node);
+static int split_child(bplus_inner_t * parent, uint32_t index);
+static void fix_child(bplus_inner_t * parent, uint32_t index);
+static void borrow_left(bplus_inner_t * parent, uint32_t index);
+static void borrow_right(bplus_inner_t * parent, uint32_t index);
+static void merge_children(bplus_inner_t * parent, uint32_t index);
+
+bplus_tree_t * bplus_tree_create(compare_f compare, destroy_f destroy)
+{
+    if (NULL == compare)
+    {
+        return NULL;
+    }
+
+    bplus_tree_t * tree = calloc(1, sizeof(*tree));
+
+    if (tree != NULL)
+    {
+        tree->compare = compare;
+        tree->destroy = destroy;
+    }
+
+    return tree;
+}
+
+void bplus_tree_destroy(bplus_tree_t * tree)
+{
+    if (tree != NULL)
+    {
+        if (tree->root != NULL)
+        {
+            free_subtree(tree, tree->root, true);
+        }
+        free(tree);
+    }
+}
+
+int bplus_tree_insert(bplus_tree_t * tree, void * data)
+{
+    if (NULL == tree)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    if (NULL == tree->root)
+    {
+        tree->root = create_node(true);
+
+        if (NULL == tree->root)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    // Full nodes are split on the way down so a split never has to travel back up
+    if (BPLUS_ORDER == tree->root->count)
+    {
+        bplus_inner_t * root = (bplus_inner_t *)create_node(false);
+
+        if (NULL == root)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        root->children[0] = tree->root;
+
+        if (split_child(root, 0) != OK)
+        {
+            free(root);
+            return ALLOCATION_ERROR;
+        }
+
+        tree->root = &(root->node);
+    }
+
+    bplus_node_t * node = tree->root;
+    while (!node->leaf)
+    {
+        bplus_inner_t * inner = (bplus_inner_t *)node;
+        uint32_t index = upper_bound(tree, node, data);
+
+        if (BPLUS_ORDER == inner->children[index]->count)
+        {
+            if (split_child(inner, index) != OK)
+            {
+                return ALLOCATION_ERROR;
+            }
+
+            // The new separator decides which half takes the data
+            if (tree->compare(data, node->keys[index]) <= 0)
+            {
+                index++;
+            }
+        }
+
+        node = inner->children[index];
+    }
+
+    uint32_t index = lower_bound(tree, node, data);
+
+    if ((index < node->count) && (0 == tree->compare(data, node->keys[index])))
+    {
+        return KEY_EXISTS;
+    }
+
+    memmove(&(node->keys[index + 1]), &(node->keys[index]), (node->count - index) * sizeof(void *));
+    node->keys[index] = data;
+    node->count++;
+    tree->size++;
+    return OK;
+}
+
+void * bplus_tree_search(bplus_tree_t * tree, void * data)
+{
+    if ((NULL == tree) || (NULL == tree->root))
+    {
+        return NULL;
+    }
+
+    bplus_node_t * leaf = &(find_leaf(tree, data)->node);
+    uint32_t index = lower_bound(tree, leaf, data);
+
+    if ((index < leaf->count) && (0 == tree->compare(data, leaf->keys[index])))
+    {
+        return leaf->keys[index];
+    }
+
+    return NULL;
+}
+
+void * bplus_tree_delete(bplus_tree_t * tree, void * data)
+{
+    if ((NULL == tree) || (NULL == tree->root))
+    {
+        return NULL;
+    }
+
+    // Children at the minimum are topped up before entering them, so the leaf never underflows
+    bplus_node_t * node = tree->root;
+    void ** separator = NULL;
+    while (!node->leaf)
+    {
+        bplus_inner_t * inner = (bplus_inner_t *)node;
+        uint32_t index = upper_bound(tree, node, data);
+
+        if (BPLUS_MIN == inner->children[index]->count)
+        {
+            fix_child(inner, index);
+
+            // A merge can empty the root, its only child takes over
+            if ((node == tree->root) && (0 == node->count))
+            {
+                tree->root = inner->children[0];
+                free(node);
+                node = tree->root;
+                continue;
+            }
+
+            index = upper_bound(tree, node, data);
+        }
+
+        // A separator equal to data must not outlive it in the leaf
+        if ((index > 0) && (0 == tree->compare(data, node->keys[index - 1])))
+        {
+            separator = &(node->keys[index - 1]);
+        }
+
+        node = inner->children[index];
+    }
+
+    uint32_t index = lower_bound(tree, node, data);
+
+    if ((index == node->count) || (tree->compare(data, node->keys[index]) != 0))
+    {
+        return NULL;
+    }
+
+    void * found = node->keys[index];
+    memmove(&(node->keys[index]), &(node->keys[index + 1]), (node->count - index - 1) * sizeof(void *));
+    node->count--;
+    tree->size--;
+
+    // The key was the smallest under the separator, the leaf's new first key replaces it
+    if ((separator != NULL) && (*separator == found))
+    {
+        *separator = node->keys[0];
+    }
+
+    return found;
+}
+
+void bplus_tree_range(bplus_tree_t * tree, void * lo, void * hi, visit_f visit, void * arg)
+{
+    if ((NULL == tree) || (NULL == tree->root) || (NULL == visit))
+    {
+        return;
+    }
+
+    // One descent to lo, after that the scan only follows the leaf chain
+    bplus_leaf_t * leaf = find_leaf(tree, lo);
+    uint32_t index = lower_bound(tree, &(leaf->node), lo);
+    while (leaf != NULL)
+    {
+        for (; index < leaf->node.count; index++)
+        {
+            if (tree->compare(leaf->node.keys[index], hi) < 0)
+            {
+                return;
+            }
+
+            visit(leaf->node.keys[index], arg);
+        }
+
+        leaf = leaf->next;
+        index = 0;
+    }
+}
+
+int bplus_tree_build_sorted(bplus_tree_t * tree, void ** array, size_t count)
+{
+    if (NULL == tree)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if ((NULL == array) && (count > 0))
+    {
+        return DATA_NULL;
+    }
+    else if (tree->size > 0)
+    {
+        return STRUCTURE_FULL;
+    }
+    else if (0 == count)
+    {
+        return OK;
+    }
+
+    for (size_t i = 1; i < count; i++)
+    {
+        int data_check = tree->compare(array[i - 1], array[i]);
+        if (0 == data_check)
+        {
+            return KEY_EXISTS;
+        }
+        else if (data_check < 0)
+        {
+            return DATA_ERROR;
+        }
+    }
+
+    size_t width = (count + BPLUS_ORDER - 1) / BPLUS_ORDER;
+    bplus_node_t ** level = malloc(width * sizeof(*level));
+
+    if (NULL == level)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    // Keys are spread evenly, so with more than one leaf each stays above the minimum
+    size_t used = 0;
+    bplus_leaf_t * previous = NULL;
+    for (size_t i = 0; i < width; i++)
+    {
+        bplus_node_t * leaf = create_node(true);
+
+        if (NULL == leaf)
+        {
+            free_level(tree, level, 0, i);
+            free(level);
+            return ALLOCATION_ERROR;
+        }
+
+        leaf->count = (uint32_t)((count - used) / (width - i));
+        memcpy(leaf->keys, &(array[used]), leaf->count * sizeof(void *));
+        used += leaf->count;
+
+        if (previous != NULL)
+        {
+            previous->next = (bplus_leaf_t *)leaf;
+        }
+
+        previous = (bplus_leaf_t *)leaf;
+        level[i] = leaf;
+    }
+
+    // Group each level under parents in place, a parent is written only after its children are read
+    while (width > 1)
+    {
+        size_t parents = (width + BPLUS_ORDER) / (BPLUS_ORDER + 1);
+        size_t read = 0;
+        for (size_t i = 0; i < parents; i++)
+        {
+            bplus_inner_t * inner = (bplus_inner_t *)create_node(false);
+
+            if (NULL == inner)
+            {
+                // Parents built so far sit at the front, subtrees not yet grouped at the back
+                free_level(tree, level, 0, i);
+                free_level(tree, level, read, width);
+                free(level);
+                return ALLOCATION_ERROR;
+            }
+
+            size_t take = (width - read) / (parents - i);
+            for (size_t j = 0; j < take; j++)
+            {
+                inner->children[j] = level[read + j];
+
+                if (j > 0)
+                {
+                    inner->node.keys[j - 1] = subtree_min(level[read + j]);
+                }
+            }
+
+            inner->node.count = (uint32_t)(take - 1);
+            read += take;
+            level[i] = &(inner->node);
+        }
+
+        width = parents;
+    }
+
+    // An empty leaf can be left behind by deletes
+    if (tree->root != NULL)
+    {
+        free_subtree(tree, tree->root, false);
+    }
+
+    tree->root = level[0];
+    tree->size = count;
+    free(level);
+    return OK;
+}
+
+size_t bplus_tree_get_size(bplus_tree_t * tree)
+{
+    return (tree != NULL) ? tree->size : 0;
+}
+
+static bplus_node_t * create_node(bool leaf)
+{
+    // Round up to whole cache lines so nodes never share or straddle one unnecessarily
+    size_t size = leaf ? sizeof(bplus_leaf_t) : sizeof(bplus_inner_t);
+    size = (size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    bplus_node_t * node = aligned_alloc(CACHE_LINE, size);
+
+    if (node != NULL)
+    {
+        memset(node, 0, size);
+        node->leaf = leaf;
+    }
+
+    return node;
+}
+
+static void free_subtree(bplus_tree_t * tree, bplus_node_t * node, bool destroy_data)
+{
+    if (node->leaf)
+    {
+        // Separators only repeat leaf keys, so the data is destroyed from the leaves alone
+        if (destroy_data && tree->destroy)
+        {
+            for (uint32_t i = 0; i < node->count; i++)
+            {
+                tree->destroy(node->keys[i]);
+            }
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i <= node->count; i++)
+        {
+            free_subtree(tree, ((bplus_inner_t *)node)->children[i], destroy_data);
+        }
+    }
+
+    free(node);
+}
+
+static void free_level(bplus_tree_t * tree, bplus_node_t ** level, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++)
+    {
+        free_subtree(tree, level[i], false);
+    }
+}
+
+static uint32_t lower_bound(bplus_tree_t * tree, bplus_node_t * node, void * data)
+{
+    // First key not below data
+    uint32_t low = 0;
+    uint32_t high = node->count;
+    while (low < high)
+    {
+        uint32_t middle = low + ((high - low) / 2);
+        if (tree->compare(data, node->keys[middle]) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static uint32_t upper_bound(bplus_tree_t * tree, bplus_node_t * node, void * data)
+{
+    // First key above data, which is also the child whose range holds data
+    uint32_t low = 0;
+    uint32_t high = node->count;
+    while (low < high)
+    {
+        uint32_t middle = low + ((high - low) / 2);
+        if (tree->compare(data, node->keys[middle]) > 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return low;
+}
+
+static bplus_leaf_t * find_leaf(bplus_tree_t * tree, void * data)
+{
+    bplus_node_t * node = tree->root;
+    while (!node->leaf)
+    {
+        node = ((bplus_inner_t *)node)->children[upper_bound(tree, node, data)];
+    }
+
+    return (bplus_leaf_t *)node;
+}
+
+static void * subtree_min(bplus_node_t * node)
+{
+    while (!node->leaf)
+    {
+        node = ((bplus_inner_t *)node)->children[0];
+    }
+
+    return node->keys[0];
+}
+
+static int split_child(bplus_inner_t * parent, uint32_t index)
+{
+    bplus_node_t * child = parent->children[index];
+    bplus_node_t * sibling = create_node(child->leaf);
+
+    if (NULL == sibling)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint32_t middle = BPLUS_ORDER / 2;
+    void * separator = NULL;
+    if (child->leaf)
+    {
+        // Leaves keep every key, the right half's first key is copied up
+        sibling->count = BPLUS_ORDER - middle;
+        memcpy(sibling->keys, &(child->keys[middle]), sibling->count * sizeof(void *));
+        ((bplus_leaf_t *)sibling)->next = ((bplus_leaf_t *)child)->next;
+        ((bplus_leaf_t *)child)->next = (bplus_leaf_t *)sibling;
+        separator = sibling->keys[0];
+    }
+    else
+    {
+        // The middle key moves up and is held by neither half
+        sibling->count = BPLUS_ORDER - middle - 1;
+        memcpy(sibling->keys, &(child->keys[middle + 1]), sibling->count * sizeof(void *));
+        memcpy(((bplus_inner_t *)sibling)->children, &(((bplus_inner_t *)child)->children[middle + 1]),
+               (sibling->count + 1) * sizeof(bplus_node_t *));
+        separator = child->keys[middle];
+    }
+
+    child->count = middle;
+
+    bplus_node_t * node = &(parent->node);
+    memmove(&(node->keys[index + 1]), &(node->keys[index]), (node->count - index) * sizeof(void *));
+    memmove(&(parent->children[index + 2]), &(parent->children[index + 1]), (node->count - index) * sizeof(bplus_node_t *));
+    node->keys[index] = separator;
+    parent->children[index + 1] = sibling;
+    node->count++;
+    return OK;
+}
+
+static void fix_child(bplus_inner_t * parent, uint32_t index)
+{
+    // Borrow from a sibling that can spare a key, otherwise merge with one
+    bplus_node_t * left = (index > 0) ? parent->children[index - 1] : NULL;
+    bplus_node_t * right = (index < parent->node.count) ? parent->children[index + 1] : NULL;
+
+    if ((left != NULL) && (left->count > BPLUS_MIN))
+    {
+        borrow_left(parent, index);
+    }
+    else if ((right != NULL) && (right->count > BPLUS_MIN))
+    {
+        borrow_right(parent, index);
+    }
+    else if (left != NULL)
+    {
+        merge_children(parent, index - 1);
+    }
+    else
+    {
+        merge_children(parent, index);
+    }
+}
+
+static void borrow_left(bplus_inner_t * parent, uint32_t index)
+{
+    bplus_node_t * child = parent->children[index];
+    bplus_node_t * left = parent->children[index - 1];
+
+    memmove(&(child->keys[1]), &(child->keys[0]), child->count * sizeof(void *));
+    if (child->leaf)
+    {
+        child->keys[0] = left->keys[left->count - 1];
+        parent->node.keys[index - 1] = child->keys[0];
+    }
+    else
+    {
+        // Rotate through the parent, its separator comes down and the left's last key goes up
+        bplus_inner_t * inner = (bplus_inner_t *)child;
+        memmove(&(inner->children[1]), &(inner->children[0]), (child->count + 1) * sizeof(bplus_node_t *));
+        child->keys[0] = parent->node.keys[index - 1];
+        inner->children[0] = ((bplus_inner_t *)left)->children[left->count];
+        parent->node.keys[index - 1] = left->keys[left->count - 1];
+    }
+
+    child->count++;
+    left->count--;
+}
+
+static void borrow_right(bplus_inner_t * parent, uint32_t index)
+{
+    bplus_node_t * child = parent->children[index];
+    bplus_node_t * right = parent->children[index + 1];
+
+    if (child->leaf)
+    {
+        child->keys[child->count] = right->keys[0];
+        memmove(&(right->keys[0]), &(right->keys[1]), (right->count - 1) * sizeof(void *));
+        parent->node.keys[index] = right->keys[0];
+    }
+    else
+    {
+        bplus_inner_t * inner = (bplus_inner_t *)right;
+        child->keys[child->count] = parent->node.keys[index];
+        ((bplus_inner_t *)child)->children[child->count + 1] = inner->children[0];
+        parent->node.keys[index] = right->keys[0];
+        memmove(&(right->keys[0]), &(right->keys[1]), (right->count - 1) * sizeof(void *));
+        memmove(&(inner->children[0]), &(inner->children[1]), right->count * sizeof(bplus_node_t *));
+    }
+
+    child->count++;
+    right->count--;
+}
+
+static void merge_children(bplus_inner_t * parent, uint32_t index)
+{
+    // Both children are at the minimum, the right one is folded into the left
+    bplus_node_t * left = parent->children[index];
+    bplus_node_t * right = parent->children[index + 1];
+
+    if (left->leaf)
+    {
+        memcpy(&(left->keys[left->count]), right->keys, right->count * sizeof(void *));
+        left->count += right->count;
+        ((bplus_leaf_t *)left)->next = ((bplus_leaf_t *)right)->next;
+    }
+    else
+    {
+        left->keys[left->count] = parent->node.keys[index];
+        memcpy(&(left->keys[left->count + 1]), right->keys, right->count * sizeof(void *));
+        memcpy(&(((bplus_inner_t *)left)->children[left->count + 1]), ((bplus_inner_t *)right)->children,
+               (right->count + 1) * sizeof(bplus_node_t *));
+        left->count += right->count + 1;
+    }
+
+    bplus_node_t * node = &(parent->node);
+    memmove(&(node->keys[index]), &(node->keys[index + 1]), (node->count - index - 1) * sizeof(void *));
+    memmove(&(parent->children[index + 1]), &(parent->children[index + 2]), (node->count - index - 1) * sizeof(bplus_node_t *));
+    node->count--;
+    free(right);
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef _BPLUS_TREE_H_
+#define _BPLUS_TREE_H_
+
+#include <stddef.h>
+#include <dstruct_funcs.h>
+
+// Ordered set of data pointers kept in wide nodes, with the data held only in
+// the leaves and the leaves chained in order. compare follows search_tree_t,
+// it is positive when the first argument sorts before the second.
+typedef struct bplus_tree bplus_tree_t;
+
+bplus_tree_t * bplus_tree_create(compare_f compare, destroy_f destroy);
+void bplus_tree_destroy(bplus_tree_t * tree);
+int bplus_tree_insert(bplus_tree_t * tree, void * data);
+void * bplus_tree_search(bplus_tree_t * tree, void * data);
+void * bplus_tree_delete(bplus_tree_t * tree, void * data);
+// Visits every element from lo to hi inclusive in order
+void bplus_tree_range(bplus_tree_t * tree, void * lo, void * hi, visit_f visit, void * arg);
+// Array must be strictly increasing and the tree empty
+int bplus_tree_build_sorted(bplus_tree_t * tree, void ** array, size_t count);
+size_t bplus_tree_get_size(bplus_tree_t * tree);
+
+#endif
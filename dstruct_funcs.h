@@ -1,9 +1,13 @@
 #ifndef _DSTRUCT_FUNCS_H_
 #define _DSTRUCT_FUNCS_H_
 
+#include <stddef.h>
+
 typedef void (*destroy_f)(void * arg);
 typedef int (*compare_f)(const void * arg1, const void * arg2);
 typedef void (*print_f)(const void * arg);
+typedef void (*visit_f)(void * data, void * arg);
+typedef size_t (*hash_f)(const void * arg);
 
 typedef enum {
     STRUCTURE_NULL = -7, STRUCTURE_FULL, 
@@ -21,6 +21,7 @@ struct pathfinder
 };
 
 static int compare_weights(const void * arg1, const void * arg2);
+static size_t hash_vertex(const void * arg);
 static int get_vertex_index(pathfinder_t * pathfinder, int vertex);
 static int find_nth_smallest(pathfinder_t * pathfinder, int n);
 static int find_next_smallest_distance(pathfinder_t * pathfinder);
@@ -44,8 +45,8 @@ pathfinder_t * pathfinder_create(size_t size)
     pathfinder->distances = calloc(size, sizeof(*(pathfinder->distances)));
     pathfinder->previous = calloc(size, sizeof(*(pathfinder->previous)));
     pathfinder->path = calloc(size, sizeof(*(pathfinder->path)));
-    pathfinder->visited = set_create(size, compare_weights);
-    pathfinder->unvisited = set_create(size, compare_weights);
+    pathfinder->visited = set_create_hash(size, compare_weights, hash_vertex);
+    pathfinder->unvisited = set_create_hash(size, compare_weights, hash_vertex);
 
     if ((NULL == pathfinder->verticies) || (NULL == pathfinder->distances) || 
         (NULL == pathfinder->previous) || (NULL == pathfinder->visited) || 
@@ -186,6 +187,11 @@ static int compare_weights(const void * arg1, const void * arg2)
     return *weight2 - *weight1;
 }
 
+static size_t hash_vertex(const void * arg)
+{
+    return (size_t)*(const int *)arg;
+}
+
 static int get_vertex_index(pathfinder_t * pathfinder, int vertex)
 {
     if ((NULL == pathfinder) || (vertex < 0))
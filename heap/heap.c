@@ -1,32 +1,63 @@
 #include <heap.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
+#define CACHE_LINE_SZ 64
+
+// Elements are stored inline in the heap's array, no allocation per insert
 typedef struct element
 {
-    size_t idx;
     void * key;
     void * data;
 } element_t;
 
+struct heap_handle
+{
+    size_t idx;
+};
+
 struct heap
 {
-    element_t ** data_array;
+    element_t * data_array;
+    void * raw_array;
+    // Parallel to data_array, only allocated once a handle is requested
+    heap_handle_t ** handles;
     compare_f compare;
     size_t size;
+    // Floor for shrinking, raised by heap_reserve
+    size_t min_size;
     size_t filled;
+    // Inserts and removes since the array last changed size
+    size_t since_resize;
+    size_t arity;
 };
 
-static void heapify_insert(heap_t * heap, element_t * element);
-static void heapify_extract(heap_t * heap, element_t * element);
-static element_t * get_parent(element_t ** data_array, size_t child_index);
-static element_t * get_lchild(heap_t * heap, size_t idx);
-static element_t * get_rchild(heap_t * heap, size_t idx);
-static void swap_nodes(element_t ** data_array, size_t parent_idx, size_t child_idx);
+static void heapify_insert(heap_t * heap, size_t idx);
+static void heapify_extract(heap_t * heap, size_t idx);
+static void heapify(heap_t * heap, size_t idx);
+static void build_heap(heap_t * heap);
+static void sort_sift_down(void ** array, size_t idx, size_t size, compare_f compare);
+static void move_element(heap_t * heap, size_t dst_idx, size_t src_idx);
+static void place_element(heap_t * heap, size_t idx, element_t element, heap_handle_t * handle);
+static element_t remove_element(heap_t * heap, size_t idx);
+static size_t get_parent(heap_t * heap, size_t child_idx);
+static size_t get_first_child(heap_t * heap, size_t idx);
+static element_t * allocate_array(size_t size, void ** raw_array);
+static int resize_array(heap_t * heap, size_t size);
+static bool valid_handle(heap_t * heap, heap_handle_t * handle);
+static int reserve_handles(heap_t * heap, heap_t * other);
 
 heap_t * heap_create(size_t size, compare_f compare)
+{
+    return heap_create_arity(size, compare, HEAP_DEFAULT_ARITY);
+}
+
+heap_t * heap_create_arity(size_t size, compare_f compare, size_t arity)
 {
 
-    if ((0 == size) || (NULL == compare))
+    if ((0 == size) || (NULL == compare) || (arity < 2))
     {
         return NULL;
     }
@@ -35,9 +66,12 @@ heap_t * heap_create(size_t size, compare_f compare)
 
     if (heap != NULL)
     {
+        // The initial size is also the smallest the heap will shrink back down to
         heap->size = size;
+        heap->min_size = size;
         heap->compare = compare;
-        heap->data_array = calloc(size, sizeof(element_t *));
+        heap->arity = arity;
+        heap->data_array = allocate_array(size, &(heap->raw_array));
 
         if (NULL == heap->data_array)
         {
@@ -50,13 +84,45 @@ heap_t * heap_create(size_t size, compare_f compare)
     return heap;
 }
 
+heap_t * heap_create_from_array(void ** keys, void ** data, size_t size, compare_f compare)
+{
+    if ((NULL == keys) || (NULL == data))
+    {
+        return NULL;
+    }
+
+    heap_t * heap = heap_create(size, compare);
+
+    if (NULL == heap)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if ((NULL == keys[i]) || (NULL == data[i]))
+        {
+            // Same rules as heap_insert, keys and data can not be NULL
+            heap_destroy(heap, NULL, NULL);
+            return NULL;
+        }
+
+        heap->data_array[i].key = keys[i];
+        heap->data_array[i].data = data[i];
+    }
+
+    heap->filled = size;
+    build_heap(heap);
+    return heap;
+}
+
 void heap_destroy(heap_t * heap, destroy_f destroy_key, destroy_f destroy_data)
 {
     if (heap != NULL)
     {
         for (size_t i = 0; i < heap->filled; i++)
         {
-            element_t * tmp_element = heap->data_array[i];
+            element_t * tmp_element = &(heap->data_array[i]);
 
             if (destroy_key != NULL)
             {
@@ -68,15 +134,24 @@ void heap_destroy(heap_t * heap, destroy_f destroy_key, destroy_f destroy_data)
                 destroy_data(tmp_element->data);
             }
 
-            free(tmp_element);
+            if (heap->handles != NULL)
+            {
+                free(heap->handles[i]);
+            }
         }
 
-        free(heap->data_array);
+        free(heap->handles);
+        free(heap->raw_array);
         free(heap);
     }
 }
 
 int heap_insert(heap_t * heap, void * key, void * data)
+{
+    return heap_insert_handle(heap, key, data, NULL);
+}
+
+int heap_insert_handle(heap_t * heap, void * key, void * data, heap_handle_t ** handle)
 {
 
     if (NULL == heap)
@@ -91,27 +166,42 @@ int heap_insert(heap_t * heap, void * key, void * data)
     {
         return DATA_NULL;
     }
-    else if (heap->filled == heap->size)
+    else if ((heap->filled == heap->size) && (resize_array(heap, heap->size * 2) != OK))
     {
-        return HEAP_FULL;
+        // Heap is full and could not grow
+        return ALLOCATION_ERROR;
     }
-    else
+
+    heap_handle_t * new_handle = NULL;
+    if (handle != NULL)
     {
-        element_t * element = calloc(1, sizeof(*element));
+        if (NULL == heap->handles)
+        {
+            // First handle requested, start tracking the handle of every element
+            heap->handles = calloc(heap->size, sizeof(heap_handle_t *));
 
-        if (NULL == element)
+            if (NULL == heap->handles)
+            {
+                return ALLOCATION_ERROR;
+            }
+        }
+
+        new_handle = malloc(sizeof(*new_handle));
+
+        if (NULL == new_handle)
         {
             return ALLOCATION_ERROR;
         }
 
-        element->key = key;
-        element->data = data;
-        element->idx = heap->filled;
-        heap->data_array[element->idx] = element;
-        heapify_insert(heap, element);
-        heap->filled++;
+        *handle = new_handle;
     }
-    
+
+    // Place the new element at the end of the array and move it up
+    element_t element = { .key = key, .data = data };
+    place_element(heap, heap->filled, element, new_handle);
+    heap->filled++;
+    heap->since_resize++;
+    heapify_insert(heap, heap->filled - 1);
     return OK;
 }
 
@@ -119,7 +209,7 @@ void heap_print(heap_t * heap, print_f print)
 {
     for (size_t i = 0; i < heap->filled; i++)
     {
-        print(heap->data_array[i]->data);
+        print(heap->data_array[i].data);
     }
 }
 
@@ -130,121 +220,480 @@ void * heap_extract(heap_t * heap, destroy_f destroy_key)
         return NULL;
     }
 
-    element_t * return_element = heap->data_array[0];
-    element_t * new_root = heap->data_array[heap->filled - 1];
-    heap->data_array[heap->filled - 1] = NULL;
-    new_root->idx = 0;
-    heap->data_array[0] = new_root;
-    heapify_extract(heap, new_root);
+    element_t return_element = remove_element(heap, 0);
 
     if (destroy_key != NULL)
     {
-        destroy_key(return_element->key);
+        destroy_key(return_element.key);
     }
 
-    void * return_data = return_element->data;
-    free(return_element);
-    heap->filled--;
-    return return_data;
+    return return_element.data;
+}
+
+void * heap_replace(heap_t * heap, void * key, void * data, destroy_f destroy_key)
+{
+    // Extract and insert in one sift, the new element goes straight into the root
+    if ((NULL == heap) || (0 == heap->filled) || (NULL == key) || (NULL == data))
+    {
+        return NULL;
+    }
+
+    element_t return_element = heap->data_array[0];
+
+    if (heap->handles != NULL)
+    {
+        // The handle of the replaced element is no longer valid
+        free(heap->handles[0]);
+        heap->handles[0] = NULL;
+    }
+
+    heap->data_array[0].key = key;
+    heap->data_array[0].data = data;
+    heapify_extract(heap, 0);
+
+    if (destroy_key != NULL)
+    {
+        destroy_key(return_element.key);
+    }
+
+    return return_element.data;
+}
+
+void * heap_peek(heap_t * heap)
+{
+    if ((NULL == heap) || (0 == heap->filled))
+    {
+        return NULL;
+    }
+
+    return heap->data_array[0].data;
+}
+
+void * heap_peek_key(heap_t * heap)
+{
+    if ((NULL == heap) || (0 == heap->filled))
+    {
+        return NULL;
+    }
+
+    return heap->data_array[0].key;
 }
 
-static void heapify_insert(heap_t * heap, element_t * element)
+int heap_update_key(heap_t * heap, heap_handle_t * handle, void * key)
 {
+    if (NULL == heap)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if ((NULL == key) || !valid_handle(heap, handle))
+    {
+        return KEY_ERROR;
+    }
+
+    // The key may have moved either way, heapify picks the direction
+    heap->data_array[handle->idx].key = key;
+    heapify(heap, handle->idx);
+    return OK;
+}
+
+void * heap_remove(heap_t * heap, heap_handle_t * handle, destroy_f destroy_key)
+{
+    if ((NULL == heap) || !valid_handle(heap, handle))
+    {
+        return NULL;
+    }
+
+    element_t return_element = remove_element(heap, handle->idx);
+
+    if (destroy_key != NULL)
+    {
+        destroy_key(return_element.key);
+    }
+
+    return return_element.data;
+}
+
+int heap_reserve(heap_t * heap, size_t size)
+{
+    if (NULL == heap)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    if ((size > heap->size) && (resize_array(heap, size) != OK))
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    // Keep the reservation through later extracts
+    heap->min_size = (size > heap->min_size) ? size : heap->min_size;
+    return OK;
+}
+
+size_t heap_get_size(heap_t * heap)
+{
+    return (heap != NULL) ? heap->filled : 0;
+}
+
+int heap_merge(heap_t * heap, heap_t * other)
+{
+    // Moves every element of other into heap, other is left empty
+    if ((NULL == heap) || (NULL == other))
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (heap == other)
+    {
+        return DATA_ERROR;
+    }
+    else if (0 == other->filled)
+    {
+        return OK;
+    }
+
+    if (reserve_handles(heap, other) != OK)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    size_t start = heap->filled;
+    size_t total = heap->filled + other->filled;
+
+    // Grown directly, merging is not a reservation and should not raise min_size
+    if ((total > heap->size) && (resize_array(heap, total) != OK))
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    for (size_t i = 0; i < other->filled; i++)
+    {
+        heap_handle_t * handle = (other->handles != NULL) ? other->handles[i] : NULL;
+        place_element(heap, start + i, other->data_array[i], handle);
+
+        if (other->handles != NULL)
+        {
+            other->handles[i] = NULL;
+        }
+    }
+
+    heap->filled = total;
+    other->filled = 0;
+
+    // Sifting each new element up costs about m log n, rebuilding the whole heap costs n + m
+    size_t levels = 0;
+    for (size_t i = total; i > 1; i /= heap->arity)
+    {
+        levels++;
+    }
+
+    if ((total - start) * levels < total)
+    {
+        for (size_t i = start; i < total; i++)
+        {
+            heapify_insert(heap, i);
+        }
+    }
+    else
+    {
+        build_heap(heap);
+    }
+
+    return OK;
+}
+
+void heap_sort(void ** array, size_t size, compare_f compare)
+{
+    // In place heapsort, leaves the array in the order heap_extract would return it
+    if ((NULL == array) || (NULL == compare) || (size < 2))
+    {
+        return;
+    }
+
+    // Build a heap with the last element to be extracted at the root
+    for (size_t i = size / 2; i > 0; i--)
+    {
+        sort_sift_down(array, i - 1, size, compare);
+    }
+
+    for (size_t end = size - 1; end > 0; end--)
+    {
+        // Move the root behind the shrinking heap
+        void * tmp = array[0];
+        array[0] = array[end];
+        array[end] = tmp;
+        sort_sift_down(array, 0, end, compare);
+    }
+}
+
+static void heapify_insert(heap_t * heap, size_t idx)
+{
+    // Move parents down into the hole instead of swapping at every level
+    element_t element = heap->data_array[idx];
+    heap_handle_t * handle = (heap->handles != NULL) ? heap->handles[idx] : NULL;
+    while (idx != 0)
+    {
+        size_t parent_idx = get_parent(heap, idx);
+        int comparison = heap->compare(heap->data_array[parent_idx].key, element.key);
+        if (comparison > 0)
+        {
+            // The new element is larger so move the parent down
+            move_element(heap, idx, parent_idx);
+            idx = parent_idx;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    place_element(heap, idx, element, handle);
+}
+
+static void heapify_extract(heap_t * heap, size_t idx)
+{
+    element_t element = heap->data_array[idx];
+    heap_handle_t * handle = (heap->handles != NULL) ? heap->handles[idx] : NULL;
     for (;;)
     {
-        if (element->idx != 0)
+        size_t first_idx = get_first_child(heap, idx);
+        if (first_idx >= heap->filled)
         {
-            element_t * parent = get_parent(heap->data_array, element->idx);
-            int comparison = heap->compare(parent->key, element->key);
-            if (comparison > 0)
-            {
-                // The new element is larger so swap data and key with the parent
-                swap_nodes(heap->data_array, parent->idx, element->idx);
-            }
-            else
-            {
-                break;
-            }
+            // No children left
+            break;
+        }
+
+        size_t last_idx = first_idx + heap->arity;
+        if (last_idx > heap->filled)
+        {
+            last_idx = heap->filled;
+        }
+
+        // Find the largest child, selecting the index avoids a branch per child
+        size_t max_idx = first_idx;
+        for (size_t child_idx = first_idx + 1; child_idx < last_idx; child_idx++)
+        {
+            int comparison = heap->compare(heap->data_array[child_idx].key, heap->data_array[max_idx].key);
+            max_idx = (comparison < 0) ? child_idx : max_idx;
+        }
+
+        int comparison = heap->compare(heap->data_array[max_idx].key, element.key);
+        if (comparison < 0)
+        {
+            // Move the larger child up into the hole
+            move_element(heap, idx, max_idx);
+            idx = max_idx;
         }
         else
         {
             break;
         }
     }
-    
+
+    place_element(heap, idx, element, handle);
+}
+
+static void heapify(heap_t * heap, size_t idx)
+{
+    // Restore the heap around an element whose key may now be larger or smaller
+    if ((idx != 0) && (heap->compare(heap->data_array[get_parent(heap, idx)].key, heap->data_array[idx].key) > 0))
+    {
+        heapify_insert(heap, idx);
+    }
+    else
+    {
+        heapify_extract(heap, idx);
+    }
 }
 
-static void heapify_extract(heap_t * heap, element_t * element)
+static void build_heap(heap_t * heap)
 {
+    // Floyd's bottom up construction, sift down every parent starting from the last one
+    if (heap->filled < 2)
+    {
+        return;
+    }
+
+    for (size_t i = get_parent(heap, heap->filled - 1) + 1; i > 0; i--)
+    {
+        heapify_extract(heap, i - 1);
+    }
+}
+
+static void sort_sift_down(void ** array, size_t idx, size_t size, compare_f compare)
+{
+    void * element = array[idx];
     for (;;)
     {
-        element_t * max_child = NULL;
-        element_t * lchild = get_lchild(heap, element->idx);
-        if (lchild != NULL)
+        size_t child_idx = (2 * idx) + 1;
+        if (child_idx >= size)
         {
-            // If there is a left child mark it as the max originally
-            max_child = lchild;
+            break;
         }
 
-        element_t * rchild = get_rchild(heap, element->idx);
-        if (rchild != NULL)
+        // Pick the child that sorts last
+        if ((child_idx + 1 < size) && (compare(array[child_idx + 1], array[child_idx]) > 0))
         {
-            // If there is a right child, there must be a left child
-            // per the rules of a array heap, assume there is a left child
-            // Check to see which child is larger between the left and the right
-            int comparison = heap->compare(rchild->key, max_child->key); 
-            if (comparison < 0)
-            {
-                // Right child is larger than left child.
-                max_child = rchild;
-            }
+            child_idx++;
         }
 
-        if (max_child != NULL)
+        if (compare(array[child_idx], element) > 0)
         {
-            int comparison = heap->compare(max_child->key, element->key);
-            if (comparison < 0)
-            {
-                swap_nodes(heap->data_array, element->idx, max_child->idx);
-            }
-            else
-            {
-                break;
-            }
+            array[idx] = array[child_idx];
+            idx = child_idx;
         }
         else
         {
             break;
         }
     }
+
+    array[idx] = element;
+}
+
+static void move_element(heap_t * heap, size_t dst_idx, size_t src_idx)
+{
+    heap->data_array[dst_idx] = heap->data_array[src_idx];
+
+    if (heap->handles != NULL)
+    {
+        // Keep the handle pointing at the element's new index
+        heap->handles[dst_idx] = heap->handles[src_idx];
+
+        if (heap->handles[dst_idx] != NULL)
+        {
+            heap->handles[dst_idx]->idx = dst_idx;
+        }
+    }
+}
+
+static void place_element(heap_t * heap, size_t idx, element_t element, heap_handle_t * handle)
+{
+    heap->data_array[idx] = element;
+
+    if (heap->handles != NULL)
+    {
+        heap->handles[idx] = handle;
+
+        if (handle != NULL)
+        {
+            handle->idx = idx;
+        }
+    }
+}
+
+static element_t remove_element(heap_t * heap, size_t idx)
+{
+    element_t return_element = heap->data_array[idx];
+
+    if (heap->handles != NULL)
+    {
+        // The handle of a removed element is no longer valid
+        free(heap->handles[idx]);
+        heap->handles[idx] = NULL;
+    }
+
+    heap->filled--;
+    heap->since_resize++;
+
+    if (idx != heap->filled)
+    {
+        // Move the last element into the hole and restore the heap around it
+        move_element(heap, idx, heap->filled);
+        heapify(heap, idx);
+    }
+
+    // Shrinking waits for size / 4 operations since the last resize, so a burst
+    // that just grew the array can not be undone by the next few extracts
+    if ((heap->filled < heap->size / 4) && (heap->size / 2 >= heap->min_size) &&
+        (heap->since_resize >= heap->size / 4))
+    {
+        // Heap is mostly empty, give half of the array back.
+        // Failing to shrink is harmless, the old array is kept.
+        resize_array(heap, heap->size / 2);
+    }
+
+    return return_element;
+}
+
+static size_t get_parent(heap_t * heap, size_t child_idx)
+{
+    return (child_idx - 1) / heap->arity;
 }
 
-static element_t * get_parent(element_t ** data_array, size_t child_index)
+static size_t get_first_child(heap_t * heap, size_t idx)
 {
-    int parent_index = (child_index - 1) / 2;
-    return data_array[parent_index];
+    return (heap->arity * idx) + 1;
+}
+
+static element_t * allocate_array(size_t size, void ** raw_array)
+{
+    // Over allocate so element 1 can start on a cache line boundary.
+    // Children of node i start at arity * i + 1, so with 16 byte elements
+    // every group of 4 children fills exactly one cache line.
+    void * raw = malloc((size * sizeof(element_t)) + (2 * CACHE_LINE_SZ));
+
+    if (NULL == raw)
+    {
+        return NULL;
+    }
+
+    uintptr_t first_child = ((uintptr_t)raw + sizeof(element_t) + CACHE_LINE_SZ - 1) & ~((uintptr_t)CACHE_LINE_SZ - 1);
+    *raw_array = raw;
+    return (element_t *)(first_child - sizeof(element_t));
 }
 
-static element_t * get_lchild(heap_t * heap, size_t idx)
+static int resize_array(heap_t * heap, size_t size)
 {
-    int child_idx = (2 * idx) + 1;
-    return child_idx >= heap->filled ? NULL : heap->data_array[child_idx];
+    // Arrays are copied rather than realloc'd to keep the cache line alignment
+    void * raw_array = NULL;
+    element_t * data_array = allocate_array(size, &raw_array);
+
+    if (NULL == data_array)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    if (heap->handles != NULL)
+    {
+        heap_handle_t ** handles = realloc(heap->handles, size * sizeof(heap_handle_t *));
+
+        if (handles != NULL)
+        {
+            heap->handles = handles;
+        }
+        else if (size > heap->size)
+        {
+            // Handles must cover every element, a handle array that failed to shrink is fine
+            free(raw_array);
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    memcpy(data_array, heap->data_array, heap->filled * sizeof(element_t));
+    free(heap->raw_array);
+    heap->raw_array = raw_array;
+    heap->data_array = data_array;
+    heap->size = size;
+    heap->since_resize = 0;
+    return OK;
 }
 
-static element_t * get_rchild(heap_t * heap, size_t idx)
+static int reserve_handles(heap_t * heap, heap_t * other)
 {
-    int child_idx = (2 * idx) + 2;
-    return child_idx >= heap->filled ? NULL : heap->data_array[child_idx];
+    // Handles from the other heap need a handle array in this heap to move into
+    if ((NULL == other->handles) || (heap->handles != NULL))
+    {
+        return OK;
+    }
+
+    heap->handles = calloc(heap->size, sizeof(heap_handle_t *));
+    return (NULL == heap->handles) ? ALLOCATION_ERROR : OK;
 }
 
-static void swap_nodes(element_t ** data_array, size_t parent_idx, size_t child_idx)
+static bool valid_handle(heap_t * heap, heap_handle_t * handle)
 {
-    // Swap the points in the data array
-    element_t * tmp_element = data_array[parent_idx];
-    data_array[parent_idx] = data_array[child_idx];
-    data_array[child_idx] = tmp_element;
-    // Update indexs for swapped nodes
-    data_array[parent_idx]->idx = parent_idx;
-    data_array[child_idx]->idx = child_idx;
+    // A handle is only valid while its element is still in this heap
+    return (handle != NULL) && (heap->handles != NULL) &&
+           (handle->idx < heap->filled) && (heap->handles[handle->idx] == handle);
 }
 // END OF SOURCE
\ No newline at end of file
@@ -2,14 +2,32 @@
 #define _HEAP_H_
 
 typedef struct heap heap_t;
+// Handles stay valid until their element is extracted or removed
+typedef struct heap_handle heap_handle_t;
 
 #include <stddef.h>
 #include <dstruct_funcs.h>
 
+// Children of a node share cache lines when arity is 4 or 8, heap_create uses 2
+#define HEAP_DEFAULT_ARITY 2
+
 heap_t * heap_create(size_t size, compare_f compare);
+heap_t * heap_create_arity(size_t size, compare_f compare, size_t arity);
+heap_t * heap_create_from_array(void ** keys, void ** data, size_t size, compare_f compare);
 void heap_destroy(heap_t * heap, destroy_f destroy_key, destroy_f destroy_data);
 int heap_insert(heap_t * heap, void * key, void * data);
+int heap_insert_handle(heap_t * heap, void * key, void * data, heap_handle_t ** handle);
 void heap_print(heap_t * heap, print_f print);
 void * heap_extract(heap_t * heap, destroy_f destroy_key);
+void * heap_replace(heap_t * heap, void * key, void * data, destroy_f destroy_key);
+void * heap_peek(heap_t * heap);
+void * heap_peek_key(heap_t * heap);
+int heap_update_key(heap_t * heap, heap_handle_t * handle, void * key);
+void * heap_remove(heap_t * heap, heap_handle_t * handle, destroy_f destroy_key);
+// Room for at least size elements, extracts will not shrink the heap below it
+int heap_reserve(heap_t * heap, size_t size);
+size_t heap_get_size(heap_t * heap);
+int heap_merge(heap_t * heap, heap_t * other);
+void heap_sort(void ** array, size_t size, compare_f compare);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <merge_iter.h>
+#include <heap.h>
+#include <stdlib.h>
+
+#define HEAP_START_SZ 16
+
+typedef struct cursor
+{
+    void * current;
+    next_f next;
+    void * source;
+    // Only used by array sources
+    void ** array;
+    size_t size;
+    size_t idx;
+} cursor_t;
+
+struct merge_iter
+{
+    // One cursor per source that still has elements, keyed by its current element
+    heap_t * heap;
+};
+
+static int add_cursor(merge_iter_t * iter, cursor_t * cursor);
+static void * array_next(void * source);
+
+merge_iter_t * merge_iter_create(compare_f compare)
+{
+    if (NULL == compare)
+    {
+        return NULL;
+    }
+
+    merge_iter_t * iter = calloc(1, sizeof(*iter));
+
+    if (iter != NULL)
+    {
+        iter->heap = heap_create(HEAP_START_SZ, compare);
+
+        if (NULL == iter->heap)
+        {
+            free(iter);
+            iter = NULL;
+        }
+    }
+
+    return iter;
+}
+
+void merge_iter_destroy(merge_iter_t * iter)
+{
+    if (iter != NULL)
+    {
+        // Sources are owned by the caller, only the cursors are freed
+        heap_destroy(iter->heap, NULL, free);
+        free(iter);
+    }
+}
+
+int merge_iter_add(merge_iter_t * iter, next_f next, void * source)
+{
+    if (NULL == iter)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (NULL == next)
+    {
+        return DATA_NULL;
+    }
+
+    cursor_t * cursor = calloc(1, sizeof(*cursor));
+
+    if (NULL == cursor)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    cursor->next = next;
+    cursor->source = source;
+    return add_cursor(iter, cursor);
+}
+
+int merge_iter_add_array(merge_iter_t * iter, void ** array, size_t size)
+{
+    if (NULL == iter)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if ((NULL == array) && (size != 0))
+    {
+        return DATA_NULL;
+    }
+
+    cursor_t * cursor = calloc(1, sizeof(*cursor));
+
+    if (NULL == cursor)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    // The cursor is its own source and walks the array
+    cursor->next = array_next;
+    cursor->source = cursor;
+    cursor->array = array;
+    cursor->size = size;
+    return add_cursor(iter, cursor);
+}
+
+void * merge_iter_next(merge_iter_t * iter)
+{
+    if (NULL == iter)
+    {
+        return NULL;
+    }
+
+    cursor_t * cursor = heap_peek(iter->heap);
+
+    if (NULL == cursor)
+    {
+        // Every source is exhausted
+        return NULL;
+    }
+
+    void * return_data = cursor->current;
+    cursor->current = cursor->next(cursor->source);
+
+    if (cursor->current != NULL)
+    {
+        // Re-key the cursor with its next element in a single sift
+        heap_replace(iter->heap, cursor->current, cursor, NULL);
+    }
+    else
+    {
+        heap_extract(iter->heap, NULL);
+        free(cursor);
+    }
+
+    return return_data;
+}
+
+static int add_cursor(merge_iter_t * iter, cursor_t * cursor)
+{
+    cursor->current = cursor->next(cursor->source);
+
+    if (NULL == cursor->current)
+    {
+        // Source is already empty, nothing to merge
+        free(cursor);
+        return OK;
+    }
+
+    int result = heap_insert(iter->heap, cursor->current, cursor);
+
+    if (result != OK)
+    {
+        free(cursor);
+    }
+
+    return result;
+}
+
+static void * array_next(void * source)
+{
+    cursor_t * cursor = source;
+    return (cursor->idx < cursor->size) ? cursor->array[cursor->idx++] : NULL;
+}
+// END OF SOURCE
\ No newline at end of file
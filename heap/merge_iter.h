@@ -0,0 +1,19 @@
+#ifndef _MERGE_ITER_H_
+#define _MERGE_ITER_H_
+
+#include <stddef.h>
+#include <dstruct_funcs.h>
+
+// Returns the next element of a sorted source, NULL once the source is exhausted
+typedef void * (*next_f)(void * source);
+
+// Merges any number of sorted sources into one sorted stream, smallest first
+typedef struct merge_iter merge_iter_t;
+
+merge_iter_t * merge_iter_create(compare_f compare);
+void merge_iter_destroy(merge_iter_t * iter);
+int merge_iter_add(merge_iter_t * iter, next_f next, void * source);
+int merge_iter_add_array(merge_iter_t * iter, void ** array, size_t size);
+void * merge_iter_next(merge_iter_t * iter);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <top_k.h>
+#include <heap.h>
+#include <stdlib.h>
+
+struct top_k
+{
+    // Root of the heap is the smallest of the kept elements, the one to beat
+    heap_t * heap;
+    compare_f compare;
+    destroy_f destroy_key;
+    size_t k;
+};
+
+top_k_t * top_k_create(size_t k, compare_f compare, destroy_f destroy_key)
+{
+    if ((0 == k) || (NULL == compare))
+    {
+        return NULL;
+    }
+
+    top_k_t * top = calloc(1, sizeof(*top));
+
+    if (top != NULL)
+    {
+        top->k = k;
+        top->compare = compare;
+        top->destroy_key = destroy_key;
+        top->heap = heap_create(k, compare);
+
+        if (NULL == top->heap)
+        {
+            free(top);
+            top = NULL;
+        }
+    }
+
+    return top;
+}
+
+void top_k_destroy(top_k_t * top, destroy_f destroy_data)
+{
+    if (top != NULL)
+    {
+        heap_destroy(top->heap, top->destroy_key, destroy_data);
+        free(top);
+    }
+}
+
+void * top_k_offer(top_k_t * top, void * key, void * data)
+{
+    // Returns the data that did not make it, either the offered data or the element it pushed out.
+    // The key of that element is passed to destroy_key.
+    if ((NULL == top) || (NULL == key))
+    {
+        return data;
+    }
+    else if (NULL == data)
+    {
+        // Rejected, the key is released like any other rejected offer
+        if (top->destroy_key != NULL)
+        {
+            top->destroy_key(key);
+        }
+
+        return NULL;
+    }
+
+    if (heap_get_size(top->heap) < top->k)
+    {
+        if (heap_insert(top->heap, key, data) != OK)
+        {
+            // Rejected like any other offer, so its key is released the same way
+            if (top->destroy_key != NULL)
+            {
+                top->destroy_key(key);
+            }
+
+            return data;
+        }
+
+        return NULL;
+    }
+
+    if (top->compare(key, heap_peek_key(top->heap)) <= 0)
+    {
+        // Doesn't beat the smallest kept element, rejected without touching the heap
+        if (top->destroy_key != NULL)
+        {
+            top->destroy_key(key);
+        }
+
+        return data;
+    }
+
+    return heap_replace(top->heap, key, data, top->destroy_key);
+}
+
+void * top_k_extract(top_k_t * top)
+{
+    // Elements come out smallest first
+    if (NULL == top)
+    {
+        return NULL;
+    }
+
+    return heap_extract(top->heap, top->destroy_key);
+}
+
+size_t top_k_get_size(top_k_t * top)
+{
+    return (top != NULL) ? heap_get_size(top->heap) : 0;
+}
+// END OF SOURCE
\ No newline at end of file
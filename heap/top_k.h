@@ -0,0 +1,17 @@
+#ifndef _TOP_K_H_
+#define _TOP_K_H_
+
+#include <stddef.h>
+#include <dstruct_funcs.h>
+
+// Keeps the k elements whose keys sort last by compare out of a stream
+typedef struct top_k top_k_t;
+
+top_k_t * top_k_create(size_t k, compare_f compare, destroy_f destroy_key);
+void top_k_destroy(top_k_t * top, destroy_f destroy_data);
+// Returns the rejected or evicted data. NULL data is always rejected, its key still goes to destroy_key.
+void * top_k_offer(top_k_t * top, void * key, void * data);
+void * top_k_extract(top_k_t * top);
+size_t top_k_get_size(top_k_t * top);
+
+#endif
\ No newline at end of file
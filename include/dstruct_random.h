@@ -0,0 +1,24 @@
+#ifndef _DSTRUCT_RANDOM_H_
+#define _DSTRUCT_RANDOM_H_
+
+#include <stdint.h>
+
+// Internal helper shared by the concurrent structures, not part of the public API
+
+static inline uint32_t dstruct_random(void)
+{
+    // Per thread xorshift, seeded from the address of the thread's state
+    static _Thread_local uint32_t state = 0;
+
+    if (0 == state)
+    {
+        state = (uint32_t)(uintptr_t)&state | 1;
+    }
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include <multi_queue.h>
+#include <dstruct_random.h>
+#include <heap.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CACHE_LINE_SZ 64
+#define HEAP_START_SZ 16
+
+// Each heap sits on its own cache line so threads working different heaps don't share lines
+typedef struct sub_queue
+{
+    _Alignas(CACHE_LINE_SZ) pthread_mutex_t lock;
+    heap_t * heap;
+} sub_queue_t;
+
+struct multi_queue
+{
+    sub_queue_t * queues;
+    size_t queue_count;
+    size_t choices;
+    compare_f compare;
+    _Atomic size_t filled;
+    atomic_bool stats_enabled;
+    _Atomic size_t extracts;
+    _Atomic size_t rank_error_sum;
+    _Atomic size_t rank_error_max;
+    _Atomic size_t skipped;
+};
+
+static sub_queue_t * lock_random(multi_queue_t * queue);
+static void * extract_any(multi_queue_t * queue, void ** key);
+static void record_rank_error(multi_queue_t * queue, void * key);
+
+multi_queue_t * multi_queue_create(size_t threads, size_t factor, size_t choices, compare_f compare)
+{
+    if ((0 == threads) || (0 == factor) || (0 == choices) || (NULL == compare))
+    {
+        return NULL;
+    }
+
+    multi_queue_t * queue = calloc(1, sizeof(*queue));
+
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    queue->queue_count = threads * factor;
+    queue->choices = choices;
+    queue->compare = compare;
+    queue->queues = aligned_alloc(CACHE_LINE_SZ, queue->queue_count * sizeof(sub_queue_t));
+
+    if (NULL == queue->queues)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < queue->queue_count; i++)
+    {
+        pthread_mutex_init(&(queue->queues[i].lock), NULL);
+        queue->queues[i].heap = heap_create(HEAP_START_SZ, compare);
+
+        if (NULL == queue->queues[i].heap)
+        {
+            // Tear down only the queues made so far
+            queue->queue_count = i + 1;
+            multi_queue_destroy(queue, NULL, NULL);
+            return NULL;
+        }
+    }
+
+    return queue;
+}
+
+void multi_queue_destroy(multi_queue_t * queue, destroy_f destroy_key, destroy_f destroy_data)
+{
+    // Not safe to call while other threads are still using the queue
+    if (NULL == queue)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < queue->queue_count; i++)
+    {
+        heap_destroy(queue->queues[i].heap, destroy_key, destroy_data);
+        pthread_mutex_destroy(&(queue->queues[i].lock));
+    }
+
+    free(queue->queues);
+    free(queue);
+}
+
+int multi_queue_insert(multi_queue_t * queue, void * key, void * data)
+{
+    if (NULL == queue)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    // Any heap will do, take the first random one that isn't busy
+    sub_queue_t * sub_queue = lock_random(queue);
+    int result = heap_insert(sub_queue->heap, key, data);
+    pthread_mutex_unlock(&(sub_queue->lock));
+
+    if (OK == result)
+    {
+        atomic_fetch_add_explicit(&(queue->filled), 1, memory_order_relaxed);
+    }
+
+    return result;
+}
+
+void * multi_queue_extract(multi_queue_t * queue)
+{
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    void * key = NULL;
+    void * data = NULL;
+    for (size_t attempt = 0; attempt < queue->queue_count; attempt++)
+    {
+        if (0 == atomic_load_explicit(&(queue->filled), memory_order_relaxed))
+        {
+            return NULL;
+        }
+
+        // Sample a few heaps and keep the lock on the one with the best top
+        sub_queue_t * best = NULL;
+        for (size_t i = 0; i < queue->choices; i++)
+        {
+            sub_queue_t * sub_queue = &(queue->queues[dstruct_random() % queue->queue_count]);
+
+            if ((sub_queue == best) || (pthread_mutex_trylock(&(sub_queue->lock)) != 0))
+            {
+                continue;
+            }
+
+            void * top = heap_peek_key(sub_queue->heap);
+
+            if ((top != NULL) && ((NULL == best) || (queue->compare(top, heap_peek_key(best->heap)) < 0)))
+            {
+                if (best != NULL)
+                {
+                    pthread_mutex_unlock(&(best->lock));
+                }
+
+                best = sub_queue;
+            }
+            else
+            {
+                pthread_mutex_unlock(&(sub_queue->lock));
+            }
+        }
+
+        if (best != NULL)
+        {
+            key = heap_peek_key(best->heap);
+            data = heap_extract(best->heap, NULL);
+            pthread_mutex_unlock(&(best->lock));
+            break;
+        }
+    }
+
+    if (NULL == data)
+    {
+        // Sampling kept missing, the queue is nearly empty or heavily contended
+        data = extract_any(queue, &key);
+    }
+
+    if (data != NULL)
+    {
+        atomic_fetch_sub_explicit(&(queue->filled), 1, memory_order_relaxed);
+
+        if (atomic_load_explicit(&(queue->stats_enabled), memory_order_relaxed))
+        {
+            record_rank_error(queue, key);
+        }
+    }
+
+    return data;
+}
+
+size_t multi_queue_get_size(multi_queue_t * queue)
+{
+    return (queue != NULL) ? atomic_load_explicit(&(queue->filled), memory_order_relaxed) : 0;
+}
+
+void multi_queue_set_stats(multi_queue_t * queue, bool enabled)
+{
+    if (queue != NULL)
+    {
+        atomic_store(&(queue->stats_enabled), enabled);
+    }
+}
+
+void multi_queue_get_stats(multi_queue_t * queue, multi_queue_stats_t * stats)
+{
+    if ((NULL == queue) || (NULL == stats))
+    {
+        return;
+    }
+
+    stats->extracts = atomic_load(&(queue->extracts));
+    stats->rank_error_sum = atomic_load(&(queue->rank_error_sum));
+    stats->rank_error_max = atomic_load(&(queue->rank_error_max));
+    stats->skipped = atomic_load(&(queue->skipped));
+}
+
+static sub_queue_t * lock_random(multi_queue_t * queue)
+{
+    for (;;)
+    {
+        sub_queue_t * sub_queue = &(queue->queues[dstruct_random() % queue->queue_count]);
+
+        if (0 == pthread_mutex_trylock(&(sub_queue->lock)))
+        {
+            return sub_queue;
+        }
+    }
+}
+
+static void * extract_any(multi_queue_t * queue, void ** key)
+{
+    // Walk every heap in order and take the top of the first one that has anything
+    for (size_t i = 0; i < queue->queue_count; i++)
+    {
+        sub_queue_t * sub_queue = &(queue->queues[i]);
+        pthread_mutex_lock(&(sub_queue->lock));
+        *key = heap_peek_key(sub_queue->heap);
+        void * data = heap_extract(sub_queue->heap, NULL);
+        pthread_mutex_unlock(&(sub_queue->lock));
+
+        if (data != NULL)
+        {
+            return data;
+        }
+    }
+
+    return NULL;
+}
+
+static void record_rank_error(multi_queue_t * queue, void * key)
+{
+    // Count the heaps whose top beats the extracted key. Busy heaps are skipped rather
+    // than waited on and counted separately, so callers can see how much the sum misses.
+    size_t rank_error = 0;
+    size_t skipped = 0;
+    for (size_t i = 0; i < queue->queue_count; i++)
+    {
+        sub_queue_t * sub_queue = &(queue->queues[i]);
+
+        if (pthread_mutex_trylock(&(sub_queue->lock)) != 0)
+        {
+            skipped++;
+            continue;
+        }
+
+        void * top = heap_peek_key(sub_queue->heap);
+
+        if ((top != NULL) && (queue->compare(top, key) < 0))
+        {
+            rank_error++;
+        }
+
+        pthread_mutex_unlock(&(sub_queue->lock));
+    }
+
+    atomic_fetch_add(&(queue->extracts), 1);
+    atomic_fetch_add(&(queue->rank_error_sum), rank_error);
+    atomic_fetch_add(&(queue->skipped), skipped);
+
+    size_t max = atomic_load(&(queue->rank_error_max));
+    while ((rank_error > max) && !atomic_compare_exchange_weak(&(queue->rank_error_max), &max, rank_error))
+    {
+        // max is reloaded by the failed exchange
+    }
+}
+// END OF SOURCE
\ No newline at end of file
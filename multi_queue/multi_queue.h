@@ -0,0 +1,32 @@
+#ifndef _MULTI_QUEUE_H_
+#define _MULTI_QUEUE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <dstruct_funcs.h>
+
+// Relaxed concurrent priority queue made of factor * threads locked heaps.
+// Extract returns a near minimal element, more choices trade throughput for quality.
+typedef struct multi_queue multi_queue_t;
+
+// Online proxy for rank error: per extract, the number of heaps whose top beat the element taken.
+// Elements under those tops are not counted and busy heaps are skipped, so it is a lower bound
+// on the true rank. Each recorded extract scans every heap, leave stats off when timing.
+typedef struct multi_queue_stats
+{
+    size_t extracts;
+    size_t rank_error_sum;
+    size_t rank_error_max;
+    // Heaps passed over because another thread held them
+    size_t skipped;
+} multi_queue_stats_t;
+
+multi_queue_t * multi_queue_create(size_t threads, size_t factor, size_t choices, compare_f compare);
+void multi_queue_destroy(multi_queue_t * queue, destroy_f destroy_key, destroy_f destroy_data);
+int multi_queue_insert(multi_queue_t * queue, void * key, void * data);
+void * multi_queue_extract(multi_queue_t * queue);
+size_t multi_queue_get_size(multi_queue_t * queue);
+void multi_queue_set_stats(multi_queue_t * queue, bool enabled);
+void multi_queue_get_stats(multi_queue_t * queue, multi_queue_stats_t * stats);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include <blocking_priority_queue.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CACHE_LINE_SZ 64
+#define USED_WORDS (PRIORITY_MAX_LEVELS / 64)
+#define NSEC_PER_SEC 1000000000ull
+
+// Each level sits on its own cache line so producers of different levels don't share lines
+typedef struct level
+{
+    _Alignas(CACHE_LINE_SZ) pthread_mutex_t lock;
+    priority_queue_t * queue;
+} level_t;
+
+struct blocking_priority_queue
+{
+    level_t * levels;
+    size_t level_count;
+    // Bit set for every level that has data waiting, only changed under that level's lock
+    _Atomic uint64_t used[USED_WORDS];
+    _Atomic size_t filled;
+    _Atomic size_t waiters;
+    atomic_bool closed;
+    pthread_mutex_t wait_lock;
+    pthread_cond_t not_empty;
+};
+
+static bool highest_level(blocking_priority_queue_t * queue, size_t * level);
+static void * wait_extract(blocking_priority_queue_t * queue, const struct timespec * deadline);
+static void wake_waiter(blocking_priority_queue_t * queue);
+
+blocking_priority_queue_t * blocking_priority_queue_create(size_t size, size_t levels)
+{
+    if ((0 == levels) || (levels > PRIORITY_MAX_LEVELS))
+    {
+        return NULL;
+    }
+
+    blocking_priority_queue_t * queue = calloc(1, sizeof(*queue));
+
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    queue->levels = aligned_alloc(CACHE_LINE_SZ, levels * sizeof(level_t));
+
+    if (NULL == queue->levels)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    // Timed waits are measured against the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&(queue->not_empty), &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&(queue->wait_lock), NULL);
+
+    queue->level_count = levels;
+    for (size_t i = 0; i < levels; i++)
+    {
+        // Every level is its own single level FIFO
+        pthread_mutex_init(&(queue->levels[i].lock), NULL);
+        queue->levels[i].queue = priority_queue_create_levels(size, 1);
+
+        if (NULL == queue->levels[i].queue)
+        {
+            // Tear down only the levels made so far
+            queue->level_count = i + 1;
+            blocking_priority_queue_destroy(queue, NULL);
+            return NULL;
+        }
+    }
+
+    return queue;
+}
+
+void blocking_priority_queue_destroy(blocking_priority_queue_t * queue, destroy_f destroy)
+{
+    // Not safe to call while other threads are still using the queue
+    if (NULL == queue)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < queue->level_count; i++)
+    {
+        priority_queue_destroy(queue->levels[i].queue, destroy);
+        pthread_mutex_destroy(&(queue->levels[i].lock));
+    }
+
+    pthread_cond_destroy(&(queue->not_empty));
+    pthread_mutex_destroy(&(queue->wait_lock));
+    free(queue->levels);
+    free(queue);
+}
+
+int blocking_priority_queue_insert(blocking_priority_queue_t * queue, void * data, priority_t priority)
+{
+    if (NULL == queue)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if ((size_t)priority >= queue->level_count)
+    {
+        return KEY_ERROR;
+    }
+    else if (NULL == data)
+    {
+        return DATA_NULL;
+    }
+
+    level_t * level = &(queue->levels[priority]);
+    pthread_mutex_lock(&(level->lock));
+    int result = priority_queue_insert(level->queue, data, LOW);
+
+    if (OK == result)
+    {
+        // Counted before the unlock so an extract of this data never sees the count go negative
+        atomic_fetch_or(&(queue->used[priority / 64]), (uint64_t)1 << (priority % 64));
+        atomic_fetch_add(&(queue->filled), 1);
+    }
+
+    pthread_mutex_unlock(&(level->lock));
+
+    if (OK == result)
+    {
+        wake_waiter(queue);
+    }
+
+    return result;
+}
+
+void * blocking_priority_queue_try_extract(blocking_priority_queue_t * queue)
+{
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    size_t idx = 0;
+    while (highest_level(queue, &idx))
+    {
+        level_t * level = &(queue->levels[idx]);
+        pthread_mutex_lock(&(level->lock));
+        void * data = priority_queue_extract(level->queue);
+
+        if (data != NULL)
+        {
+            atomic_fetch_sub(&(queue->filled), 1);
+        }
+
+        if (0 == priority_queue_get_size(level->queue))
+        {
+            atomic_fetch_and(&(queue->used[idx / 64]), ~((uint64_t)1 << (idx % 64)));
+        }
+
+        pthread_mutex_unlock(&(level->lock));
+
+        if (data != NULL)
+        {
+            return data;
+        }
+
+        // Another consumer emptied the level first, look again
+    }
+
+    return NULL;
+}
+
+void * blocking_priority_queue_extract(blocking_priority_queue_t * queue)
+{
+    return (queue != NULL) ? wait_extract(queue, NULL) : NULL;
+}
+
+void * blocking_priority_queue_timed_extract(blocking_priority_queue_t * queue, uint64_t timeout_ns)
+{
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t nsec = (uint64_t)deadline.tv_nsec + (timeout_ns % NSEC_PER_SEC);
+    deadline.tv_sec += (time_t)((timeout_ns / NSEC_PER_SEC) + (nsec / NSEC_PER_SEC));
+    deadline.tv_nsec = (long)(nsec % NSEC_PER_SEC);
+    return wait_extract(queue, &deadline);
+}
+
+size_t blocking_priority_queue_extract_up_to(blocking_priority_queue_t * queue, void ** array, size_t count)
+{
+    if ((NULL == queue) || (NULL == array))
+    {
+        return 0;
+    }
+
+    // Drain whole levels under a single lock each, highest level first
+    size_t filled = 0;
+    size_t idx = 0;
+    while ((filled < count) && highest_level(queue, &idx))
+    {
+        level_t * level = &(queue->levels[idx]);
+        size_t taken = 0;
+        pthread_mutex_lock(&(level->lock));
+
+        while ((filled < count) && (priority_queue_get_size(level->queue) != 0))
+        {
+            array[filled++] = priority_queue_extract(level->queue);
+            taken++;
+        }
+
+        atomic_fetch_sub(&(queue->filled), taken);
+
+        if (0 == priority_queue_get_size(level->queue))
+        {
+            atomic_fetch_and(&(queue->used[idx / 64]), ~((uint64_t)1 << (idx % 64)));
+        }
+
+        pthread_mutex_unlock(&(level->lock));
+    }
+
+    return filled;
+}
+
+void blocking_priority_queue_close(blocking_priority_queue_t * queue)
+{
+    if (NULL == queue)
+    {
+        return;
+    }
+
+    // Blocked consumers drain what is left and then get NULL instead of waiting
+    pthread_mutex_lock(&(queue->wait_lock));
+    atomic_store(&(queue->closed), true);
+    pthread_cond_broadcast(&(queue->not_empty));
+    pthread_mutex_unlock(&(queue->wait_lock));
+}
+
+size_t blocking_priority_queue_get_size(blocking_priority_queue_t * queue)
+{
+    return (queue != NULL) ? atomic_load_explicit(&(queue->filled), memory_order_relaxed) : 0;
+}
+
+static bool highest_level(blocking_priority_queue_t * queue, size_t * level)
+{
+    for (size_t word = USED_WORDS; word > 0; word--)
+    {
+        uint64_t used = atomic_load_explicit(&(queue->used[word - 1]), memory_order_acquire);
+
+        if (used != 0)
+        {
+            *level = ((word - 1) * 64) + 63 - (size_t)__builtin_clzll(used);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void * wait_extract(blocking_priority_queue_t * queue, const struct timespec * deadline)
+{
+    for (;;)
+    {
+        void * data = blocking_priority_queue_try_extract(queue);
+
+        if (data != NULL)
+        {
+            return data;
+        }
+
+        // Waiters is raised before filled is checked and producers bump filled before
+        // checking waiters, so one side always sees the other and no wakeup is lost
+        pthread_mutex_lock(&(queue->wait_lock));
+        atomic_fetch_add(&(queue->waiters), 1);
+
+        int result = 0;
+        while ((0 == atomic_load(&(queue->filled))) && !atomic_load(&(queue->closed)) && (0 == result))
+        {
+            result = (NULL == deadline) ? pthread_cond_wait(&(queue->not_empty), &(queue->wait_lock)) :
+                     pthread_cond_timedwait(&(queue->not_empty), &(queue->wait_lock), deadline);
+        }
+
+        atomic_fetch_sub(&(queue->waiters), 1);
+        bool closed = atomic_load(&(queue->closed));
+        pthread_mutex_unlock(&(queue->wait_lock));
+
+        if ((result != 0) || closed)
+        {
+            // Timed out or closed, take whatever is there without waiting again
+            return blocking_priority_queue_try_extract(queue);
+        }
+    }
+}
+
+static void wake_waiter(blocking_priority_queue_t * queue)
+{
+    // Producers only touch the wait lock when a consumer is actually asleep
+    if (atomic_load(&(queue->waiters)) != 0)
+    {
+        pthread_mutex_lock(&(queue->wait_lock));
+        pthread_cond_signal(&(queue->not_empty));
+        pthread_mutex_unlock(&(queue->wait_lock));
+    }
+}
+// END OF SOURCE
\ No newline at end of file
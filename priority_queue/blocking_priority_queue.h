@@ -0,0 +1,23 @@
+#ifndef _BLOCKING_PRIORITY_QUEUE_H_
+#define _BLOCKING_PRIORITY_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <priority_queue.h>
+#include <dstruct_funcs.h>
+
+// Thread safe priority queue with one lock per level, higher levels are extracted first.
+// Extract blocks until data arrives or the queue is closed.
+typedef struct blocking_priority_queue blocking_priority_queue_t;
+
+blocking_priority_queue_t * blocking_priority_queue_create(size_t size, size_t levels);
+void blocking_priority_queue_destroy(blocking_priority_queue_t * queue, destroy_f destroy);
+int blocking_priority_queue_insert(blocking_priority_queue_t * queue, void * data, priority_t priority);
+void * blocking_priority_queue_try_extract(blocking_priority_queue_t * queue);
+void * blocking_priority_queue_extract(blocking_priority_queue_t * queue);
+void * blocking_priority_queue_timed_extract(blocking_priority_queue_t * queue, uint64_t timeout_ns);
+size_t blocking_priority_queue_extract_up_to(blocking_priority_queue_t * queue, void ** array, size_t count);
+void blocking_priority_queue_close(blocking_priority_queue_t * queue);
+size_t blocking_priority_queue_get_size(blocking_priority_queue_t * queue);
+
+#endif
\ No newline at end of file
@@ -1,32 +1,78 @@
 #include <priority_queue.h>
-#include <heap.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-struct priority_queue
+#define MIN_RING_SZ 8
+#define USED_WORDS (PRIORITY_MAX_LEVELS / 64)
+// Log linear latency bins: values below SUB_BUCKETS get a bin each, every power of two
+// above that is split into SUB_BUCKETS equal bins, so a bin is at most 1/16 of its value wide
+#define SUB_BITS 4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define HISTOGRAM_SZ (SUB_BUCKETS * (64 - SUB_BITS + 1))
+
+// FIFO ring buffer for a single level, size is always a power of two
+typedef struct ring
 {
-    heap_t * heap;
-    priority_t priority[PRIORITY_SZ];
-};
+    void ** data_array;
+    // Insert time of each item, only allocated in aging mode
+    uint64_t * stamps;
+    size_t size;
+    size_t head;
+    size_t filled;
+} ring_t;
 
-typedef struct key 
+struct priority_queue
 {
-    int priority;
-} queue_key_t;
+    ring_t * levels;
+    size_t level_count;
+    size_t ring_size;
+    size_t filled;
+    // Bit set for every level that has data waiting
+    uint64_t used[USED_WORDS];
+    // Aging mode only, NULL otherwise
+    uint64_t * quanta;
+    // Log linear bins of extract latency in nanoseconds, one row per level
+    uint64_t (*histograms)[HISTOGRAM_SZ];
+};
 
-static int compare(const void * arg1, const void * arg2);
+static int ring_grow(priority_queue_t * queue, ring_t * ring);
+static void ring_copy(void * dst, const void * src, ring_t * ring, size_t element_size);
+static size_t highest_level(priority_queue_t * queue);
+static size_t aged_level(priority_queue_t * queue, uint64_t now);
+static size_t latency_bin(uint64_t latency);
+static uint64_t bin_upper_edge(size_t bin);
+static uint64_t get_time(void);
 
 priority_queue_t * priority_queue_create(size_t size)
 {
+    return priority_queue_create_levels(size, PRIORITY_SZ);
+}
+
+priority_queue_t * priority_queue_create_levels(size_t size, size_t levels)
+{
+    if ((0 == levels) || (levels > PRIORITY_MAX_LEVELS))
+    {
+        return NULL;
+    }
+
     priority_queue_t * queue = calloc(1, (sizeof(*queue)));
 
     if (queue != NULL)
     {
-        priority_t tmp[] = {LOW, MEDIUM, HIGH, CRITICAL};
-        memcpy(queue->priority, &tmp, sizeof(int) * PRIORITY_SZ);
-        queue->heap = heap_create(size, compare);
-        
-        if (NULL == queue->heap)
+        // Rings are allocated the first time their level is used
+        queue->level_count = levels;
+        queue->ring_size = MIN_RING_SZ;
+        while (queue->ring_size < size)
+        {
+            queue->ring_size *= 2;
+        }
+
+        queue->levels = calloc(levels, sizeof(ring_t));
+
+        if (NULL == queue->levels)
         {
             free(queue);
             queue = NULL;
@@ -36,16 +82,56 @@ priority_queue_t * priority_queue_create(size_t size)
     return queue;
 }
 
+priority_queue_t * priority_queue_create_aging(size_t size, size_t levels, const uint64_t * quanta)
+{
+    if (NULL == quanta)
+    {
+        return NULL;
+    }
+
+    priority_queue_t * queue = priority_queue_create_levels(size, levels);
+
+    if (queue != NULL)
+    {
+        queue->quanta = malloc(levels * sizeof(uint64_t));
+        queue->histograms = calloc(levels, sizeof(*(queue->histograms)));
+
+        if ((NULL == queue->quanta) || (NULL == queue->histograms))
+        {
+            priority_queue_destroy(queue, NULL);
+            return NULL;
+        }
+
+        memcpy(queue->quanta, quanta, levels * sizeof(uint64_t));
+    }
+
+    return queue;
+}
+
 void priority_queue_destroy(priority_queue_t * queue, destroy_f destroy_value)
 {
 
     if (queue != NULL)
     {
-        if (queue->heap != NULL)
+        for (size_t i = 0; i < queue->level_count; i++)
         {
-            heap_destroy(queue->heap, NULL, destroy_value);   
+            ring_t * ring = &(queue->levels[i]);
+
+            if (destroy_value != NULL)
+            {
+                for (size_t j = 0; j < ring->filled; j++)
+                {
+                    destroy_value(ring->data_array[(ring->head + j) & (ring->size - 1)]);
+                }
+            }
+
+            free(ring->data_array);
+            free(ring->stamps);
         }
-        
+
+        free(queue->quanta);
+        free(queue->histograms);
+        free(queue->levels);
         free(queue);
         return;
     }
@@ -53,39 +139,230 @@ void priority_queue_destroy(priority_queue_t * queue, destroy_f destroy_value)
 
 int priority_queue_insert(priority_queue_t * queue, void * data, priority_t priority)
 {
+    if (NULL == queue)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if ((size_t)priority >= queue->level_count)
+    {
+        return KEY_ERROR;
+    }
+    else if (NULL == data)
+    {
+        return DATA_NULL;
+    }
+
+    ring_t * ring = &(queue->levels[priority]);
 
-    priority_t * key = NULL;
-    switch (priority)
+    if ((ring->filled == ring->size) && (ring_grow(queue, ring) != OK))
     {
-        case CRITICAL:
-            key = &(queue->priority[CRITICAL]);
-            break;
-        case HIGH:
-            key = &(queue->priority[HIGH]);
-            break;
-        case MEDIUM:
-            key = &(queue->priority[MEDIUM]);
-            break;
-        case LOW:
-            key = &(queue->priority[LOW]);
-            break;
-        default:
-            return KEY_ERROR;
+        return ALLOCATION_ERROR;
     }
 
-    return heap_insert(queue->heap, key, data);
+    // Append to the back of the level's ring
+    ring->data_array[(ring->head + ring->filled) & (ring->size - 1)] = data;
+
+    if (queue->quanta != NULL)
+    {
+        ring->stamps[(ring->head + ring->filled) & (ring->size - 1)] = get_time();
+    }
+
+    ring->filled++;
+    queue->filled++;
+    queue->used[priority / 64] |= (uint64_t)1 << (priority % 64);
+    return OK;
 }
 
 void * priority_queue_extract(priority_queue_t * queue)
 {
-    return heap_extract(queue->heap, NULL);
+    if ((NULL == queue) || (0 == queue->filled))
+    {
+        return NULL;
+    }
+
+    // Take the front of the highest level that has data, or with aging the
+    // front that has the highest level once its waiting time is counted
+    uint64_t now = (queue->quanta != NULL) ? get_time() : 0;
+    size_t level = (queue->quanta != NULL) ? aged_level(queue, now) : highest_level(queue);
+    ring_t * ring = &(queue->levels[level]);
+    void * return_data = ring->data_array[ring->head];
+
+    if (queue->quanta != NULL)
+    {
+        queue->histograms[level][latency_bin(now - ring->stamps[ring->head])]++;
+    }
+
+    ring->head = (ring->head + 1) & (ring->size - 1);
+    ring->filled--;
+    queue->filled--;
+
+    if (0 == ring->filled)
+    {
+        queue->used[level / 64] &= ~((uint64_t)1 << (level % 64));
+    }
+
+    return return_data;
+}
+
+size_t priority_queue_get_size(priority_queue_t * queue)
+{
+    return (queue != NULL) ? queue->filled : 0;
 }
 
-static int compare(const void * arg1, const void * arg2)
+uint64_t priority_queue_get_latency(priority_queue_t * queue, priority_t priority, double percentile)
 {
-    priority_t * priority1 = (priority_t *)arg1;
-    priority_t * priority2 = (priority_t *)arg2;
+    if ((NULL == queue) || (NULL == queue->histograms) || ((size_t)priority >= queue->level_count))
+    {
+        return 0;
+    }
 
-    return *priority2 - *priority1;
+    uint64_t * histogram = queue->histograms[priority];
+    uint64_t total = 0;
+    for (size_t i = 0; i < HISTOGRAM_SZ; i++)
+    {
+        total += histogram[i];
+    }
+
+    if (0 == total)
+    {
+        return 0;
+    }
+
+    // Rank of the sample the percentile falls on, clamped to the first and last sample
+    double target = (percentile / 100.0) * (double)total;
+    uint64_t rank = (target < 1.0) ? 1 : (uint64_t)target;
+    rank = ((double)rank < target) ? rank + 1 : rank;
+    rank = (rank > total) ? total : rank;
+
+    // Report the upper edge of the bin holding that sample, within 1/16 above the true value
+    uint64_t seen = histogram[0];
+    size_t bin = 0;
+    while (seen < rank)
+    {
+        bin++;
+        seen += histogram[bin];
+    }
+
+    return bin_upper_edge(bin);
+}
+
+static size_t latency_bin(uint64_t latency)
+{
+    if (latency < SUB_BUCKETS)
+    {
+        return (size_t)latency;
+    }
+
+    // The top SUB_BITS + 1 bits pick the bin, the leading one selects the power of two
+    size_t exponent = 63 - (size_t)__builtin_clzll(latency);
+    size_t shift = exponent - SUB_BITS;
+    return (SUB_BUCKETS * (shift + 1)) + (size_t)((latency >> shift) & (SUB_BUCKETS - 1));
+}
+
+static uint64_t bin_upper_edge(size_t bin)
+{
+    if (bin < SUB_BUCKETS)
+    {
+        return bin;
+    }
+
+    size_t shift = (bin / SUB_BUCKETS) - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + (bin % SUB_BUCKETS)) << shift;
+    return lower + (((uint64_t)1 << shift) - 1);
+}
+
+static int ring_grow(priority_queue_t * queue, ring_t * ring)
+{
+    size_t size = (0 == ring->size) ? queue->ring_size : ring->size * 2;
+    void ** data_array = malloc(size * sizeof(void *));
+    uint64_t * stamps = (queue->quanta != NULL) ? malloc(size * sizeof(uint64_t)) : NULL;
+
+    if ((NULL == data_array) || ((queue->quanta != NULL) && (NULL == stamps)))
+    {
+        free(data_array);
+        free(stamps);
+        return ALLOCATION_ERROR;
+    }
+
+    ring_copy(data_array, ring->data_array, ring, sizeof(void *));
+    free(ring->data_array);
+    ring->data_array = data_array;
+
+    if (stamps != NULL)
+    {
+        ring_copy(stamps, ring->stamps, ring, sizeof(uint64_t));
+        free(ring->stamps);
+        ring->stamps = stamps;
+    }
+
+    ring->size = size;
+    ring->head = 0;
+    return OK;
+}
+
+static void ring_copy(void * dst, const void * src, ring_t * ring, size_t element_size)
+{
+    if (0 == ring->filled)
+    {
+        return;
+    }
+
+    // Unwrap the old ring so the data starts at index 0 of the new one
+    size_t first_part = ring->size - ring->head;
+    first_part = (first_part < ring->filled) ? first_part : ring->filled;
+    memcpy(dst, (const char *)src + (ring->head * element_size), first_part * element_size);
+    memcpy((char *)dst + (first_part * element_size), src, (ring->filled - first_part) * element_size);
+}
+
+static size_t highest_level(priority_queue_t * queue)
+{
+    // Only called when something is queued, so some bit is set
+    size_t word = USED_WORDS - 1;
+    while (0 == queue->used[word])
+    {
+        word--;
+    }
+
+    return (word * 64) + 63 - (size_t)__builtin_clzll(queue->used[word]);
+}
+
+static size_t aged_level(priority_queue_t * queue, uint64_t now)
+{
+    // Each ring is FIFO so its front has waited longest, only the fronts are compared.
+    // Walking from the top down means ties go to the higher level.
+    size_t best_level = 0;
+    uint64_t best_priority = 0;
+    bool found = false;
+    for (size_t word = USED_WORDS; word > 0; word--)
+    {
+        uint64_t used = queue->used[word - 1];
+
+        while (used != 0)
+        {
+            size_t bit = 63 - (size_t)__builtin_clzll(used);
+            size_t level = ((word - 1) * 64) + bit;
+            used &= ~((uint64_t)1 << bit);
+
+            ring_t * ring = &(queue->levels[level]);
+            uint64_t age = now - ring->stamps[ring->head];
+            uint64_t priority = level + ((queue->quanta[level] != 0) ? age / queue->quanta[level] : 0);
+
+            if (!found || (priority > best_priority))
+            {
+                best_level = level;
+                best_priority = priority;
+                found = true;
+            }
+        }
+    }
+
+    return best_level;
+}
+
+static uint64_t get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
 }
 // END OF SOURCE
\ No newline at end of file
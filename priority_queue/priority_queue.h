@@ -3,14 +3,25 @@
 
 #include <dstruct_funcs.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// Most levels a queue can be created with, level 0 is the lowest priority
+#define PRIORITY_MAX_LEVELS 256
 
 typedef struct priority_queue priority_queue_t;
 
 typedef enum {LOW, MEDIUM, HIGH, CRITICAL, PRIORITY_SZ} priority_t;
 
 priority_queue_t * priority_queue_create(size_t size);
+priority_queue_t * priority_queue_create_levels(size_t size, size_t levels);
+// Aging mode, an item waiting quanta[level] nanoseconds counts as one level higher.
+// A quantum of 0 never ages, extract latency is tracked per level.
+priority_queue_t * priority_queue_create_aging(size_t size, size_t levels, const uint64_t * quanta);
 void priority_queue_destroy(priority_queue_t * queue, destroy_f destroy);
 int priority_queue_insert(priority_queue_t * queue, void * data, priority_t priority);
 void * priority_queue_extract(priority_queue_t * queue);
+size_t priority_queue_get_size(priority_queue_t * queue);
+// Extract latency in nanoseconds at a percentile, aging mode only. Never low, at most 1/16 high.
+uint64_t priority_queue_get_latency(priority_queue_t * queue, priority_t priority, double percentile);
 
 #endif
\ No newline at end of file
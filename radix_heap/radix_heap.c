@@ -0,0 +1,282 @@
+#include <radix_heap.h>
+#include <stdlib.h>
+
+// Bucket 0 holds keys equal to the last extracted key, bucket i holds keys
+// whose highest bit differing from the last extracted key is bit i - 1
+#define BUCKET_SZ 65
+#define MIN_BUCKET_SZ 8
+
+typedef struct element
+{
+    uint64_t key;
+    void * data;
+} element_t;
+
+typedef struct bucket
+{
+    element_t * data_array;
+    size_t size;
+    size_t filled;
+} bucket_t;
+
+struct radix_heap
+{
+    bucket_t buckets[BUCKET_SZ];
+    // Bit i - 1 is set when bucket i is not empty
+    uint64_t used;
+    uint64_t last;
+    // First allocation of a bucket, each bucket gets a share of the creation size
+    size_t bucket_size;
+    size_t filled;
+};
+
+static size_t get_bucket(radix_heap_t * heap, uint64_t key);
+static int bucket_push(radix_heap_t * heap, size_t idx, uint64_t key, void * data);
+static int bucket_reserve(radix_heap_t * heap, size_t idx, size_t size);
+static void bucket_release(radix_heap_t * heap, size_t idx);
+static int redistribute(radix_heap_t * heap);
+
+radix_heap_t * radix_heap_create(size_t size)
+{
+    radix_heap_t * heap = calloc(1, sizeof(*heap));
+
+    if (heap != NULL)
+    {
+        // Buckets are allocated the first time they are used. Keys usually spread
+        // over many buckets, so each starts with a share of size and grows from there.
+        size_t share = size / BUCKET_SZ;
+        heap->bucket_size = (share > MIN_BUCKET_SZ) ? share : MIN_BUCKET_SZ;
+    }
+
+    return heap;
+}
+
+void radix_heap_destroy(radix_heap_t * heap, destroy_f destroy_data)
+{
+    if (NULL == heap)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < BUCKET_SZ; i++)
+    {
+        bucket_t * bucket = &(heap->buckets[i]);
+
+        if (destroy_data != NULL)
+        {
+            for (size_t j = 0; j < bucket->filled; j++)
+            {
+                destroy_data(bucket->data_array[j].data);
+            }
+        }
+
+        free(bucket->data_array);
+    }
+
+    free(heap);
+}
+
+int radix_heap_insert(radix_heap_t * heap, uint64_t key, void * data)
+{
+    if (NULL == heap)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (key < heap->last)
+    {
+        // Keys must never go below the last extracted key
+        return KEY_ERROR;
+    }
+    else if (NULL == data)
+    {
+        return DATA_NULL;
+    }
+
+    int result = bucket_push(heap, get_bucket(heap, key), key, data);
+
+    if (OK == result)
+    {
+        heap->filled++;
+    }
+
+    return result;
+}
+
+void * radix_heap_extract(radix_heap_t * heap, uint64_t * key)
+{
+    if ((NULL == heap) || (0 == heap->filled))
+    {
+        return NULL;
+    }
+
+    if (redistribute(heap) != OK)
+    {
+        return NULL;
+    }
+
+    // Every key in bucket 0 is the minimum, take the last one
+    bucket_t * bucket = &(heap->buckets[0]);
+    bucket->filled--;
+    heap->filled--;
+    element_t element = bucket->data_array[bucket->filled];
+
+    if (0 == bucket->filled)
+    {
+        bucket_release(heap, 0);
+    }
+
+    if (key != NULL)
+    {
+        *key = element.key;
+    }
+
+    return element.data;
+}
+
+void * radix_heap_peek(radix_heap_t * heap, uint64_t * key)
+{
+    if ((NULL == heap) || (0 == heap->filled))
+    {
+        return NULL;
+    }
+
+    if (redistribute(heap) != OK)
+    {
+        return NULL;
+    }
+
+    bucket_t * bucket = &(heap->buckets[0]);
+
+    if (key != NULL)
+    {
+        *key = bucket->data_array[bucket->filled - 1].key;
+    }
+
+    return bucket->data_array[bucket->filled - 1].data;
+}
+
+size_t radix_heap_get_size(radix_heap_t * heap)
+{
+    return (heap != NULL) ? heap->filled : 0;
+}
+
+static size_t get_bucket(radix_heap_t * heap, uint64_t key)
+{
+    uint64_t difference = key ^ heap->last;
+    return (0 == difference) ? 0 : (size_t)(64 - __builtin_clzll(difference));
+}
+
+static int bucket_push(radix_heap_t * heap, size_t idx, uint64_t key, void * data)
+{
+    bucket_t * bucket = &(heap->buckets[idx]);
+
+    if ((bucket->filled == bucket->size) && (bucket_reserve(heap, idx, bucket->filled + 1) != OK))
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    bucket->data_array[bucket->filled].key = key;
+    bucket->data_array[bucket->filled].data = data;
+    bucket->filled++;
+
+    if (idx != 0)
+    {
+        heap->used |= (uint64_t)1 << (idx - 1);
+    }
+
+    return OK;
+}
+
+static int bucket_reserve(radix_heap_t * heap, size_t idx, size_t size)
+{
+    bucket_t * bucket = &(heap->buckets[idx]);
+
+    if (size <= bucket->size)
+    {
+        return OK;
+    }
+
+    // Grow the bucket geometrically
+    size_t new_size = (0 == bucket->size) ? heap->bucket_size : bucket->size;
+    while (new_size < size)
+    {
+        new_size *= 2;
+    }
+
+    element_t * data_array = realloc(bucket->data_array, new_size * sizeof(element_t));
+
+    if (NULL == data_array)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    bucket->data_array = data_array;
+    bucket->size = new_size;
+    return OK;
+}
+
+static void bucket_release(radix_heap_t * heap, size_t idx)
+{
+    // Empty buckets that grew past their first allocation give the memory back,
+    // smaller ones are kept since the same buckets fill again and again
+    bucket_t * bucket = &(heap->buckets[idx]);
+
+    if (bucket->size > heap->bucket_size)
+    {
+        free(bucket->data_array);
+        bucket->data_array = NULL;
+        bucket->size = 0;
+    }
+}
+
+static int redistribute(radix_heap_t * heap)
+{
+    if (heap->buckets[0].filled != 0)
+    {
+        // Minimum is already in bucket 0
+        return OK;
+    }
+
+    // Lowest non empty bucket holds the minimum
+    size_t idx = (size_t)__builtin_ctzll(heap->used) + 1;
+    bucket_t * bucket = &(heap->buckets[idx]);
+
+    uint64_t minimum = bucket->data_array[0].key;
+    for (size_t i = 1; i < bucket->filled; i++)
+    {
+        minimum = (bucket->data_array[i].key < minimum) ? bucket->data_array[i].key : minimum;
+    }
+
+    // With the minimum as the new last key every element of the bucket lands in a lower bucket.
+    // Make room in those buckets first so a failed allocation leaves the heap untouched.
+    size_t counts[BUCKET_SZ] = {0};
+    uint64_t last = heap->last;
+    heap->last = minimum;
+    for (size_t i = 0; i < bucket->filled; i++)
+    {
+        counts[get_bucket(heap, bucket->data_array[i].key)]++;
+    }
+
+    for (size_t i = 0; i < idx; i++)
+    {
+        if ((counts[i] != 0) && (bucket_reserve(heap, i, heap->buckets[i].filled + counts[i]) != OK))
+        {
+            heap->last = last;
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    heap->used &= ~((uint64_t)1 << (idx - 1));
+    size_t filled = bucket->filled;
+    bucket->filled = 0;
+
+    for (size_t i = 0; i < filled; i++)
+    {
+        element_t element = bucket->data_array[i];
+        bucket_push(heap, get_bucket(heap, element.key), element.key, element.data);
+    }
+
+    bucket_release(heap, idx);
+    return OK;
+}
+// END OF SOURCE
\ No newline at end of file
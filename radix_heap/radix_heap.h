@@ -0,0 +1,20 @@
+#ifndef _RADIX_HEAP_H_
+#define _RADIX_HEAP_H_
+
+typedef struct radix_heap radix_heap_t;
+
+#include <stddef.h>
+#include <stdint.h>
+#include <dstruct_funcs.h>
+
+// Monotone min priority queue for unsigned integer keys (32 bit keys fit as is).
+// A key may not be smaller than the last key extracted.
+// size is the expected element count, spread over the buckets as they are first used
+radix_heap_t * radix_heap_create(size_t size);
+void radix_heap_destroy(radix_heap_t * heap, destroy_f destroy_data);
+int radix_heap_insert(radix_heap_t * heap, uint64_t key, void * data);
+void * radix_heap_extract(radix_heap_t * heap, uint64_t * key);
+void * radix_heap_peek(radix_heap_t * heap, uint64_t * key);
+size_t radix_heap_get_size(radix_heap_t * heap);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1266 @@
+#include <roaring.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_MAX 4096
+#define BITMAP_WORDS 1024
+#define MAX_RUNS 32768
+#define MIN_ARRAY_SZ 4
+#define MIN_CONTAINERS 4
+#define SERIAL_MAGIC 0x52524f52u
+#define HEADER_SZ 8
+#define CONTAINER_HEADER_SZ 8
+
+typedef enum {ARRAY_CONTAINER, BITMAP_CONTAINER, RUN_CONTAINER} container_type_t;
+
+// Holds the low 16 bits of every value in one chunk
+typedef struct container
+{
+    // Sorted values for arrays, start and length - 1 pairs for runs
+    uint16_t * array;
+    uint64_t * bitmap;
+    uint32_t cardinality;
+    // Entries used and allocated in array, each run takes two
+    uint32_t filled;
+    uint32_t size;
+    uint8_t type;
+} container_t;
+
+struct roaring
+{
+    // Chunk keys are sorted and kept apart from the containers so searching them stays dense
+    uint16_t * keys;
+    container_t * containers;
+    size_t count;
+    size_t size;
+};
+
+static bool find_container(roaring_t * roaring, uint16_t key, size_t * idx);
+static container_t * insert_container(roaring_t * roaring, size_t idx, uint16_t key);
+static void remove_container(roaring_t * roaring, size_t idx);
+static void container_free(container_t * container);
+static int container_copy(container_t * dst, container_t * src);
+static bool container_contains(container_t * container, uint16_t value);
+static int container_add(container_t * container, uint16_t value);
+static int container_remove(container_t * container, uint16_t value);
+static uint32_t container_rank(container_t * container, uint16_t value);
+static void container_iterate(container_t * container, uint32_t base, roaring_visit_f visit, void * arg);
+static int container_union(container_t * out, container_t * container1, container_t * container2);
+static int container_intersection(container_t * out, container_t * container1, container_t * container2);
+static int container_run_optimize(container_t * container);
+static int array_reserve(container_t * container, uint32_t size);
+static int array_to_bitmap(container_t * container);
+static int bitmap_to_array(container_t * container);
+static int run_to_plain(container_t * container);
+static int from_words(container_t * container, const uint64_t * words);
+static void or_into(uint64_t * words, container_t * container);
+static const uint64_t * get_words(container_t * container, uint64_t * scratch);
+static void set_range(uint64_t * words, uint32_t start, uint32_t end);
+static uint32_t lower_bound(const uint16_t * array, uint32_t count, uint16_t value);
+static uint32_t run_upper_bound(container_t * container, uint16_t value);
+static uint32_t count_runs(container_t * container);
+static size_t payload_size(container_t * container);
+static void put_bytes(uint8_t * buffer, uint64_t value, size_t bytes);
+static uint64_t get_bytes(const uint8_t * buffer, size_t bytes);
+static int read_container(container_t * container, uint8_t type, uint32_t count, const uint8_t * payload);
+
+roaring_t * roaring_create(void)
+{
+    roaring_t * roaring = calloc(1, sizeof(*roaring));
+
+    if (roaring != NULL)
+    {
+        roaring->size = MIN_CONTAINERS;
+        roaring->keys = malloc(roaring->size * sizeof(uint16_t));
+        roaring->containers = malloc(roaring->size * sizeof(container_t));
+
+        if ((NULL == roaring->keys) || (NULL == roaring->containers))
+        {
+            roaring_destroy(roaring);
+            roaring = NULL;
+        }
+    }
+
+    return roaring;
+}
+
+void roaring_destroy(roaring_t * roaring)
+{
+    if (NULL == roaring)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        container_free(&(roaring->containers[i]));
+    }
+
+    free(roaring->keys);
+    free(roaring->containers);
+    free(roaring);
+}
+
+int roaring_add(roaring_t * roaring, uint32_t value)
+{
+    if (NULL == roaring)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    size_t idx = 0;
+    container_t * container = NULL;
+
+    if (find_container(roaring, (uint16_t)(value >> 16), &idx))
+    {
+        container = &(roaring->containers[idx]);
+    }
+    else
+    {
+        container = insert_container(roaring, idx, (uint16_t)(value >> 16));
+
+        if (NULL == container)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    int result = container_add(container, (uint16_t)value);
+
+    if (0 == container->cardinality)
+    {
+        // A new chunk whose first add failed
+        remove_container(roaring, idx);
+    }
+
+    return result;
+}
+
+int roaring_remove(roaring_t * roaring, uint32_t value)
+{
+    if (NULL == roaring)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    size_t idx = 0;
+
+    if (!find_container(roaring, (uint16_t)(value >> 16), &idx))
+    {
+        return KEY_ERROR;
+    }
+
+    int result = container_remove(&(roaring->containers[idx]), (uint16_t)value);
+
+    if (0 == roaring->containers[idx].cardinality)
+    {
+        remove_container(roaring, idx);
+    }
+
+    return result;
+}
+
+bool roaring_contains(roaring_t * roaring, uint32_t value)
+{
+    size_t idx = 0;
+
+    if ((NULL == roaring) || !find_container(roaring, (uint16_t)(value >> 16), &idx))
+    {
+        return false;
+    }
+
+    return container_contains(&(roaring->containers[idx]), (uint16_t)value);
+}
+
+uint64_t roaring_get_cardinality(roaring_t * roaring)
+{
+    if (NULL == roaring)
+    {
+        return 0;
+    }
+
+    uint64_t cardinality = 0;
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        cardinality += roaring->containers[i].cardinality;
+    }
+
+    return cardinality;
+}
+
+uint64_t roaring_rank(roaring_t * roaring, uint32_t value)
+{
+    if (NULL == roaring)
+    {
+        return 0;
+    }
+
+    // Every chunk below value's chunk counts whole
+    size_t idx = 0;
+    bool found = find_container(roaring, (uint16_t)(value >> 16), &idx);
+    uint64_t rank = 0;
+    for (size_t i = 0; i < idx; i++)
+    {
+        rank += roaring->containers[i].cardinality;
+    }
+
+    if (found)
+    {
+        rank += container_rank(&(roaring->containers[idx]), (uint16_t)value);
+    }
+
+    return rank;
+}
+
+void roaring_iterate(roaring_t * roaring, roaring_visit_f visit, void * arg)
+{
+    if ((NULL == roaring) || (NULL == visit))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        container_iterate(&(roaring->containers[i]), (uint32_t)roaring->keys[i] << 16, visit, arg);
+    }
+}
+
+roaring_t * roaring_union(roaring_t * roaring1, roaring_t * roaring2)
+{
+    if ((NULL == roaring1) || (NULL == roaring2))
+    {
+        return NULL;
+    }
+
+    roaring_t * result = roaring_create();
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    // Walk both key lists in order, chunks found on one side only are copied
+    size_t idx1 = 0;
+    size_t idx2 = 0;
+    int result_value = OK;
+    while ((OK == result_value) && ((idx1 < roaring1->count) || (idx2 < roaring2->count)))
+    {
+        bool take1 = (idx1 < roaring1->count) && ((idx2 == roaring2->count) || (roaring1->keys[idx1] <= roaring2->keys[idx2]));
+        bool take2 = (idx2 < roaring2->count) && ((idx1 == roaring1->count) || (roaring2->keys[idx2] <= roaring1->keys[idx1]));
+        uint16_t key = take1 ? roaring1->keys[idx1] : roaring2->keys[idx2];
+        container_t * container = insert_container(result, result->count, key);
+
+        if (NULL == container)
+        {
+            result_value = ALLOCATION_ERROR;
+        }
+        else if (take1 && take2)
+        {
+            result_value = container_union(container, &(roaring1->containers[idx1]), &(roaring2->containers[idx2]));
+        }
+        else
+        {
+            result_value = container_copy(container, take1 ? &(roaring1->containers[idx1]) : &(roaring2->containers[idx2]));
+        }
+
+        idx1 += take1;
+        idx2 += take2;
+    }
+
+    if (result_value != OK)
+    {
+        roaring_destroy(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
+roaring_t * roaring_intersection(roaring_t * roaring1, roaring_t * roaring2)
+{
+    if ((NULL == roaring1) || (NULL == roaring2))
+    {
+        return NULL;
+    }
+
+    roaring_t * result = roaring_create();
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    // Only chunks present on both sides can produce anything
+    size_t idx1 = 0;
+    size_t idx2 = 0;
+    int result_value = OK;
+    while ((OK == result_value) && (idx1 < roaring1->count) && (idx2 < roaring2->count))
+    {
+        if (roaring1->keys[idx1] < roaring2->keys[idx2])
+        {
+            idx1++;
+            continue;
+        }
+        else if (roaring1->keys[idx1] > roaring2->keys[idx2])
+        {
+            idx2++;
+            continue;
+        }
+
+        container_t * container = insert_container(result, result->count, roaring1->keys[idx1]);
+
+        if (NULL == container)
+        {
+            result_value = ALLOCATION_ERROR;
+            break;
+        }
+
+        result_value = container_intersection(container, &(roaring1->containers[idx1]), &(roaring2->containers[idx2]));
+
+        if (0 == container->cardinality)
+        {
+            remove_container(result, result->count - 1);
+        }
+
+        idx1++;
+        idx2++;
+    }
+
+    if (result_value != OK)
+    {
+        roaring_destroy(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
+int roaring_run_optimize(roaring_t * roaring)
+{
+    if (NULL == roaring)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        if (container_run_optimize(&(roaring->containers[i])) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    return OK;
+}
+
+size_t roaring_serialized_size(roaring_t * roaring)
+{
+    if (NULL == roaring)
+    {
+        return 0;
+    }
+
+    size_t size = HEADER_SZ;
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        size += CONTAINER_HEADER_SZ + payload_size(&(roaring->containers[i]));
+    }
+
+    return size;
+}
+
+size_t roaring_serialize(roaring_t * roaring, void * buffer, size_t size)
+{
+    size_t needed = roaring_serialized_size(roaring);
+
+    if ((NULL == buffer) || (0 == needed) || (size < needed))
+    {
+        return 0;
+    }
+
+    // Magic and container count, then per container its key, type, count and payload
+    uint8_t * out = buffer;
+    put_bytes(out, SERIAL_MAGIC, 4);
+    put_bytes(out + 4, roaring->count, 4);
+    out += HEADER_SZ;
+
+    for (size_t i = 0; i < roaring->count; i++)
+    {
+        container_t * container = &(roaring->containers[i]);
+        uint32_t count = (RUN_CONTAINER == container->type) ? container->filled / 2 : container->cardinality;
+        put_bytes(out, roaring->keys[i], 2);
+        put_bytes(out + 2, container->type, 1);
+        put_bytes(out + 3, 0, 1);
+        put_bytes(out + 4, count, 4);
+        out += CONTAINER_HEADER_SZ;
+
+        if (BITMAP_CONTAINER == container->type)
+        {
+            for (size_t j = 0; j < BITMAP_WORDS; j++)
+            {
+                put_bytes(out + (j * 8), container->bitmap[j], 8);
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < container->filled; j++)
+            {
+                put_bytes(out + (j * 2), container->array[j], 2);
+            }
+        }
+
+        out += payload_size(container);
+    }
+
+    return needed;
+}
+
+roaring_t * roaring_deserialize(const void * buffer, size_t size)
+{
+    const uint8_t * in = buffer;
+
+    if ((NULL == buffer) || (size < HEADER_SZ) || (get_bytes(in, 4) != SERIAL_MAGIC))
+    {
+        return NULL;
+    }
+
+    roaring_t * roaring = roaring_create();
+
+    if (NULL == roaring)
+    {
+        return NULL;
+    }
+
+    size_t count = get_bytes(in + 4, 4);
+    size_t offset = HEADER_SZ;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (size - offset < CONTAINER_HEADER_SZ)
+        {
+            roaring_destroy(roaring);
+            return NULL;
+        }
+
+        uint16_t key = (uint16_t)get_bytes(in + offset, 2);
+        uint8_t type = (uint8_t)get_bytes(in + offset + 2, 1);
+        uint32_t entries = (uint32_t)get_bytes(in + offset + 4, 4);
+        offset += CONTAINER_HEADER_SZ;
+
+        // Keys must be strictly increasing and the payload must fit
+        size_t payload = (BITMAP_CONTAINER == type) ? BITMAP_WORDS * 8 :
+                         (RUN_CONTAINER == type) ? (size_t)entries * 4 : (size_t)entries * 2;
+        bool bad_key = (roaring->count != 0) && (key <= roaring->keys[roaring->count - 1]);
+        container_t * container = (bad_key || (type > RUN_CONTAINER) || (size - offset < payload)) ?
+                                  NULL : insert_container(roaring, roaring->count, key);
+
+        if ((NULL == container) || (read_container(container, type, entries, in + offset) != OK))
+        {
+            roaring_destroy(roaring);
+            return NULL;
+        }
+
+        offset += payload;
+    }
+
+    return roaring;
+}
+
+static bool find_container(roaring_t * roaring, uint16_t key, size_t * idx)
+{
+    // Appending in key order is the common case, check the last chunk first
+    if ((roaring->count != 0) && (roaring->keys[roaring->count - 1] < key))
+    {
+        *idx = roaring->count;
+        return false;
+    }
+
+    size_t low = 0;
+    size_t high = roaring->count;
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+
+        if (roaring->keys[mid] < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    *idx = low;
+    return (low < roaring->count) && (roaring->keys[low] == key);
+}
+
+static container_t * insert_container(roaring_t * roaring, size_t idx, uint16_t key)
+{
+    if (roaring->count == roaring->size)
+    {
+        uint16_t * keys = realloc(roaring->keys, roaring->size * 2 * sizeof(uint16_t));
+
+        if (NULL == keys)
+        {
+            return NULL;
+        }
+
+        roaring->keys = keys;
+        container_t * containers = realloc(roaring->containers, roaring->size * 2 * sizeof(container_t));
+
+        if (NULL == containers)
+        {
+            return NULL;
+        }
+
+        roaring->containers = containers;
+        roaring->size *= 2;
+    }
+
+    memmove(&(roaring->keys[idx + 1]), &(roaring->keys[idx]), (roaring->count - idx) * sizeof(uint16_t));
+    memmove(&(roaring->containers[idx + 1]), &(roaring->containers[idx]), (roaring->count - idx) * sizeof(container_t));
+    roaring->keys[idx] = key;
+    memset(&(roaring->containers[idx]), 0, sizeof(container_t));
+    roaring->count++;
+    return &(roaring->containers[idx]);
+}
+
+static void remove_container(roaring_t * roaring, size_t idx)
+{
+    container_free(&(roaring->containers[idx]));
+    roaring->count--;
+    memmove(&(roaring->keys[idx]), &(roaring->keys[idx + 1]), (roaring->count - idx) * sizeof(uint16_t));
+    memmove(&(roaring->containers[idx]), &(roaring->containers[idx + 1]), (roaring->count - idx) * sizeof(container_t));
+}
+
+static void container_free(container_t * container)
+{
+    free(container->array);
+    free(container->bitmap);
+    memset(container, 0, sizeof(*container));
+}
+
+static int container_copy(container_t * dst, container_t * src)
+{
+    *dst = *src;
+    dst->array = NULL;
+    dst->bitmap = NULL;
+
+    if (BITMAP_CONTAINER == src->type)
+    {
+        dst->bitmap = malloc(BITMAP_WORDS * sizeof(uint64_t));
+
+        if (NULL == dst->bitmap)
+        {
+            memset(dst, 0, sizeof(*dst));
+            return ALLOCATION_ERROR;
+        }
+
+        memcpy(dst->bitmap, src->bitmap, BITMAP_WORDS * sizeof(uint64_t));
+        return OK;
+    }
+
+    dst->size = 0;
+
+    if (array_reserve(dst, src->filled) != OK)
+    {
+        memset(dst, 0, sizeof(*dst));
+        return ALLOCATION_ERROR;
+    }
+
+    memcpy(dst->array, src->array, src->filled * sizeof(uint16_t));
+    return OK;
+}
+
+static bool container_contains(container_t * container, uint16_t value)
+{
+    if (BITMAP_CONTAINER == container->type)
+    {
+        return (container->bitmap[value / 64] >> (value % 64)) & 1;
+    }
+    else if (RUN_CONTAINER == container->type)
+    {
+        // The last run starting at or before value is the only one that can hold it
+        uint32_t runs = run_upper_bound(container, value);
+        return (runs != 0) &&
+               ((uint32_t)value <= (uint32_t)container->array[(runs - 1) * 2] + container->array[((runs - 1) * 2) + 1]);
+    }
+
+    uint32_t idx = lower_bound(container->array, container->filled, value);
+    return (idx < container->filled) && (container->array[idx] == value);
+}
+
+static int container_add(container_t * container, uint16_t value)
+{
+    if (RUN_CONTAINER == container->type)
+    {
+        if (container_contains(container, value))
+        {
+            return KEY_EXISTS;
+        }
+
+        if (run_to_plain(container) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    if (BITMAP_CONTAINER == container->type)
+    {
+        uint64_t bit = (uint64_t)1 << (value % 64);
+
+        if (container->bitmap[value / 64] & bit)
+        {
+            return KEY_EXISTS;
+        }
+
+        container->bitmap[value / 64] |= bit;
+        container->cardinality++;
+        return OK;
+    }
+
+    uint32_t idx = lower_bound(container->array, container->filled, value);
+
+    if ((idx < container->filled) && (container->array[idx] == value))
+    {
+        return KEY_EXISTS;
+    }
+
+    if (ARRAY_MAX == container->filled)
+    {
+        // A full array is already as large as a bitmap
+        if (array_to_bitmap(container) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        return container_add(container, value);
+    }
+
+    if ((container->filled == container->size) &&
+        (array_reserve(container, (0 == container->size) ? MIN_ARRAY_SZ : container->size * 2) != OK))
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    memmove(&(container->array[idx + 1]), &(container->array[idx]), (container->filled - idx) * sizeof(uint16_t));
+    container->array[idx] = value;
+    container->filled++;
+    container->cardinality++;
+    return OK;
+}
+
+static int container_remove(container_t * container, uint16_t value)
+{
+    if (RUN_CONTAINER == container->type)
+    {
+        if (!container_contains(container, value))
+        {
+            return KEY_ERROR;
+        }
+
+        if (run_to_plain(container) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+
+    if (BITMAP_CONTAINER == container->type)
+    {
+        uint64_t bit = (uint64_t)1 << (value % 64);
+
+        if (0 == (container->bitmap[value / 64] & bit))
+        {
+            return KEY_ERROR;
+        }
+
+        container->bitmap[value / 64] &= ~bit;
+        container->cardinality--;
+
+        if (container->cardinality <= ARRAY_MAX)
+        {
+            // Staying a bitmap is still correct if the smaller array can't be allocated
+            bitmap_to_array(container);
+        }
+
+        return OK;
+    }
+
+    uint32_t idx = lower_bound(container->array, container->filled, value);
+
+    if ((idx == container->filled) || (container->array[idx] != value))
+    {
+        return KEY_ERROR;
+    }
+
+    container->filled--;
+    container->cardinality--;
+    memmove(&(container->array[idx]), &(container->array[idx + 1]), (container->filled - idx) * sizeof(uint16_t));
+    return OK;
+}
+
+static uint32_t container_rank(container_t * container, uint16_t value)
+{
+    if (BITMAP_CONTAINER == container->type)
+    {
+        uint32_t rank = 0;
+        for (uint32_t i = 0; i < value / 64; i++)
+        {
+            rank += (uint32_t)__builtin_popcountll(container->bitmap[i]);
+        }
+
+        uint64_t mask = (63 == (value % 64)) ? ~(uint64_t)0 : ((uint64_t)2 << (value % 64)) - 1;
+        return rank + (uint32_t)__builtin_popcountll(container->bitmap[value / 64] & mask);
+    }
+    else if (RUN_CONTAINER == container->type)
+    {
+        uint32_t runs = run_upper_bound(container, value);
+        uint32_t rank = 0;
+        for (uint32_t i = 0; i < runs; i++)
+        {
+            uint32_t start = container->array[i * 2];
+            uint32_t end = start + container->array[(i * 2) + 1];
+            rank += ((end < value) ? end : value) - start + 1;
+        }
+
+        return rank;
+    }
+
+    uint32_t idx = lower_bound(container->array, container->filled, value);
+    return ((idx < container->filled) && (container->array[idx] == value)) ? idx + 1 : idx;
+}
+
+static void container_iterate(container_t * container, uint32_t base, roaring_visit_f visit, void * arg)
+{
+    if (BITMAP_CONTAINER == container->type)
+    {
+        for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            uint64_t word = container->bitmap[i];
+            while (word != 0)
+            {
+                visit(base | ((i * 64) + (uint32_t)__builtin_ctzll(word)), arg);
+                word &= word - 1;
+            }
+        }
+    }
+    else if (RUN_CONTAINER == container->type)
+    {
+        for (uint32_t i = 0; i < container->filled; i += 2)
+        {
+            uint32_t end = (uint32_t)container->array[i] + container->array[i + 1];
+            for (uint32_t value = container->array[i]; value <= end; value++)
+            {
+                visit(base | value, arg);
+            }
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < container->filled; i++)
+        {
+            visit(base | container->array[i], arg);
+        }
+    }
+}
+
+static int container_union(container_t * out, container_t * container1, container_t * container2)
+{
+    if ((ARRAY_CONTAINER == container1->type) && (ARRAY_CONTAINER == container2->type) &&
+        (container1->filled + container2->filled <= ARRAY_MAX))
+    {
+        if (array_reserve(out, container1->filled + container2->filled) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        uint32_t idx1 = 0;
+        uint32_t idx2 = 0;
+        while ((idx1 < container1->filled) || (idx2 < container2->filled))
+        {
+            bool take1 = (idx1 < container1->filled) &&
+                         ((idx2 == container2->filled) || (container1->array[idx1] <= container2->array[idx2]));
+            bool take2 = (idx2 < container2->filled) &&
+                         ((idx1 == container1->filled) || (container2->array[idx2] <= container1->array[idx1]));
+            out->array[out->filled++] = take1 ? container1->array[idx1] : container2->array[idx2];
+            idx1 += take1;
+            idx2 += take2;
+        }
+
+        out->cardinality = out->filled;
+        return OK;
+    }
+
+    // Anything involving a bitmap or runs is OR'd a word at a time
+    uint64_t words[BITMAP_WORDS];
+    memcpy(words, get_words(container1, words), sizeof(words));
+    or_into(words, container2);
+    return from_words(out, words);
+}
+
+static int container_intersection(container_t * out, container_t * container1, container_t * container2)
+{
+    if ((ARRAY_CONTAINER == container1->type) || (ARRAY_CONTAINER == container2->type))
+    {
+        // Probe the other side with each array value, the result can't outgrow the array
+        container_t * array = (ARRAY_CONTAINER == container1->type) ? container1 : container2;
+        container_t * other = (array == container1) ? container2 : container1;
+
+        if (array_reserve(out, array->filled) != OK)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        for (uint32_t i = 0; i < array->filled; i++)
+        {
+            if (container_contains(other, array->array[i]))
+            {
+                out->array[out->filled++] = array->array[i];
+            }
+        }
+
+        out->cardinality = out->filled;
+        return OK;
+    }
+
+    uint64_t scratch1[BITMAP_WORDS];
+    uint64_t scratch2[BITMAP_WORDS];
+    const uint64_t * words1 = get_words(container1, scratch1);
+    const uint64_t * words2 = get_words(container2, scratch2);
+    for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+    {
+        scratch1[i] = words1[i] & words2[i];
+    }
+
+    return from_words(out, scratch1);
+}
+
+static int container_run_optimize(container_t * container)
+{
+    if (RUN_CONTAINER == container->type)
+    {
+        return OK;
+    }
+
+    // Runs cost four bytes each, switch only when that beats the current form
+    uint32_t runs = count_runs(container);
+    size_t current = (BITMAP_CONTAINER == container->type) ? BITMAP_WORDS * 8 : container->filled * 2;
+
+    if ((size_t)runs * 4 >= current)
+    {
+        return OK;
+    }
+
+    uint16_t * array = malloc(runs * 2 * sizeof(uint16_t));
+
+    if (NULL == array)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint32_t filled = 0;
+    if (BITMAP_CONTAINER == container->type)
+    {
+        // Find each run by its first set bit and its first clear bit after that
+        uint32_t idx = 0;
+        uint64_t word = container->bitmap[0];
+        for (;;)
+        {
+            while ((0 == word) && (idx < BITMAP_WORDS - 1))
+            {
+                word = container->bitmap[++idx];
+            }
+
+            if (0 == word)
+            {
+                break;
+            }
+
+            uint32_t start = (idx * 64) + (uint32_t)__builtin_ctzll(word);
+            word |= word - 1;
+
+            while ((~(uint64_t)0 == word) && (idx < BITMAP_WORDS - 1))
+            {
+                word = container->bitmap[++idx];
+            }
+
+            uint32_t end = (~(uint64_t)0 == word) ? BITMAP_WORDS * 64 : (idx * 64) + (uint32_t)__builtin_ctzll(~word);
+            array[filled++] = (uint16_t)start;
+            array[filled++] = (uint16_t)(end - start - 1);
+
+            if (~(uint64_t)0 == word)
+            {
+                break;
+            }
+
+            word &= word + 1;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < container->filled; i++)
+        {
+            if ((0 == i) || (container->array[i] != container->array[i - 1] + 1))
+            {
+                array[filled++] = container->array[i];
+                array[filled++] = 0;
+            }
+            else
+            {
+                array[filled - 1]++;
+            }
+        }
+    }
+
+    free(container->array);
+    free(container->bitmap);
+    container->bitmap = NULL;
+    container->array = array;
+    container->filled = filled;
+    container->size = filled;
+    container->type = RUN_CONTAINER;
+    return OK;
+}
+
+static int array_reserve(container_t * container, uint32_t size)
+{
+    if (size <= container->size)
+    {
+        return OK;
+    }
+
+    uint16_t * array = realloc(container->array, size * sizeof(uint16_t));
+
+    if (NULL == array)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    container->array = array;
+    container->size = size;
+    return OK;
+}
+
+static int array_to_bitmap(container_t * container)
+{
+    uint64_t * bitmap = calloc(BITMAP_WORDS, sizeof(uint64_t));
+
+    if (NULL == bitmap)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    for (uint32_t i = 0; i < container->filled; i++)
+    {
+        bitmap[container->array[i] / 64] |= (uint64_t)1 << (container->array[i] % 64);
+    }
+
+    free(container->array);
+    container->array = NULL;
+    container->filled = 0;
+    container->size = 0;
+    container->bitmap = bitmap;
+    container->type = BITMAP_CONTAINER;
+    return OK;
+}
+
+static int bitmap_to_array(container_t * container)
+{
+    uint16_t * array = malloc(((container->cardinality < MIN_ARRAY_SZ) ? MIN_ARRAY_SZ : container->cardinality) * sizeof(uint16_t));
+
+    if (NULL == array)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint32_t filled = 0;
+    for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+    {
+        uint64_t word = container->bitmap[i];
+        while (word != 0)
+        {
+            array[filled++] = (uint16_t)((i * 64) + (uint32_t)__builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+
+    free(container->bitmap);
+    container->bitmap = NULL;
+    container->array = array;
+    container->filled = filled;
+    container->size = (filled < MIN_ARRAY_SZ) ? MIN_ARRAY_SZ : filled;
+    container->type = ARRAY_CONTAINER;
+    return OK;
+}
+
+static int run_to_plain(container_t * container)
+{
+    // Expand the runs into whichever plain form suits the cardinality
+    uint64_t words[BITMAP_WORDS];
+    memset(words, 0, sizeof(words));
+    or_into(words, container);
+    container_t plain = {0};
+    int result = from_words(&plain, words);
+
+    if (OK == result)
+    {
+        container_free(container);
+        *container = plain;
+    }
+
+    return result;
+}
+
+static int from_words(container_t * container, const uint64_t * words)
+{
+    uint32_t cardinality = 0;
+    for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+    {
+        cardinality += (uint32_t)__builtin_popcountll(words[i]);
+    }
+
+    container->cardinality = cardinality;
+
+    if (cardinality > ARRAY_MAX)
+    {
+        container->type = BITMAP_CONTAINER;
+        container->bitmap = malloc(BITMAP_WORDS * sizeof(uint64_t));
+
+        if (NULL == container->bitmap)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        memcpy(container->bitmap, words, BITMAP_WORDS * sizeof(uint64_t));
+        return OK;
+    }
+
+    container->type = ARRAY_CONTAINER;
+
+    if (array_reserve(container, (cardinality < MIN_ARRAY_SZ) ? MIN_ARRAY_SZ : cardinality) != OK)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+    {
+        uint64_t word = words[i];
+        while (word != 0)
+        {
+            container->array[container->filled++] = (uint16_t)((i * 64) + (uint32_t)__builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+
+    return OK;
+}
+
+static void or_into(uint64_t * words, container_t * container)
+{
+    if (BITMAP_CONTAINER == container->type)
+    {
+        for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            words[i] |= container->bitmap[i];
+        }
+    }
+    else if (RUN_CONTAINER == container->type)
+    {
+        for (uint32_t i = 0; i < container->filled; i += 2)
+        {
+            set_range(words, container->array[i], (uint32_t)container->array[i] + container->array[i + 1]);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < container->filled; i++)
+        {
+            words[container->array[i] / 64] |= (uint64_t)1 << (container->array[i] % 64);
+        }
+    }
+}
+
+static const uint64_t * get_words(container_t * container, uint64_t * scratch)
+{
+    // Bitmaps are used in place, anything else is expanded into scratch
+    if (BITMAP_CONTAINER == container->type)
+    {
+        return container->bitmap;
+    }
+
+    memset(scratch, 0, BITMAP_WORDS * sizeof(uint64_t));
+    or_into(scratch, container);
+    return scratch;
+}
+
+static void set_range(uint64_t * words, uint32_t start, uint32_t end)
+{
+    // Inclusive range, whole words in the middle are filled at once
+    uint32_t first = start / 64;
+    uint32_t last = end / 64;
+    uint64_t first_mask = ~(uint64_t)0 << (start % 64);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - (end % 64));
+
+    if (first == last)
+    {
+        words[first] |= first_mask & last_mask;
+        return;
+    }
+
+    words[first] |= first_mask;
+    for (uint32_t i = first + 1; i < last; i++)
+    {
+        words[i] = ~(uint64_t)0;
+    }
+
+    words[last] |= last_mask;
+}
+
+static uint32_t lower_bound(const uint16_t * array, uint32_t count, uint16_t value)
+{
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high)
+    {
+        uint32_t mid = low + ((high - low) / 2);
+
+        if (array[mid] < value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static uint32_t run_upper_bound(container_t * container, uint16_t value)
+{
+    // Number of runs that start at or before value
+    uint32_t low = 0;
+    uint32_t high = container->filled / 2;
+    while (low < high)
+    {
+        uint32_t mid = low + ((high - low) / 2);
+
+        if (container->array[mid * 2] <= value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static uint32_t count_runs(container_t * container)
+{
+    uint32_t runs = 0;
+
+    if (BITMAP_CONTAINER == container->type)
+    {
+        // A run starts on every set bit whose lower neighbour is clear
+        uint64_t carry = 0;
+        for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            uint64_t word = container->bitmap[i];
+            runs += (uint32_t)__builtin_popcountll(word & ~((word << 1) | carry));
+            carry = word >> 63;
+        }
+
+        return runs;
+    }
+
+    for (uint32_t i = 0; i < container->filled; i++)
+    {
+        runs += (0 == i) || (container->array[i] != container->array[i - 1] + 1);
+    }
+
+    return runs;
+}
+
+static size_t payload_size(container_t * container)
+{
+    return (BITMAP_CONTAINER == container->type) ? BITMAP_WORDS * 8 : (size_t)container->filled * 2;
+}
+
+static void put_bytes(uint8_t * buffer, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_bytes(const uint8_t * buffer, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value |= (uint64_t)buffer[i] << (8 * i);
+    }
+
+    return value;
+}
+
+static int read_container(container_t * container, uint8_t type, uint32_t count, const uint8_t * payload)
+{
+    // Everything read is checked, a corrupt buffer must not produce a broken container
+    if (BITMAP_CONTAINER == type)
+    {
+        uint64_t words[BITMAP_WORDS];
+        for (uint32_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            words[i] = get_bytes(payload + (i * 8), 8);
+        }
+
+        int result = from_words(container, words);
+        return ((OK == result) && (container->cardinality != 0) && (container->cardinality == count)) ? result : DATA_ERROR;
+    }
+
+    uint32_t limit = (RUN_CONTAINER == type) ? MAX_RUNS : ARRAY_MAX;
+
+    if ((0 == count) || (count > limit))
+    {
+        return DATA_ERROR;
+    }
+
+    uint32_t entries = (RUN_CONTAINER == type) ? count * 2 : count;
+
+    if (array_reserve(container, entries) != OK)
+    {
+        return ALLOCATION_ERROR;
+    }
+
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        container->array[i] = (uint16_t)get_bytes(payload + (i * 2), 2);
+    }
+
+    container->type = type;
+    container->filled = entries;
+    for (uint32_t i = 0; i < entries; i += (RUN_CONTAINER == type) ? 2 : 1)
+    {
+        // Values and runs must be sorted and must not touch or overlap
+        uint32_t start = container->array[i];
+        uint32_t end = (RUN_CONTAINER == type) ? start + container->array[i + 1] : start;
+
+        if (((i != 0) && (start < next)) || (end > UINT16_MAX))
+        {
+            return DATA_ERROR;
+        }
+
+        container->cardinality += end - start + 1;
+        next = end + 1 + (RUN_CONTAINER == type);
+    }
+
+    return OK;
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef _ROARING_H_
+#define _ROARING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dstruct_funcs.h>
+
+// Compressed set of 32 bit ids. Each 16 bit chunk of the id space is held in a
+// sorted array, a 65536 bit bitmap or a list of runs, whichever is smallest.
+typedef struct roaring roaring_t;
+
+typedef void (*roaring_visit_f)(uint32_t value, void * arg);
+
+roaring_t * roaring_create(void);
+void roaring_destroy(roaring_t * roaring);
+int roaring_add(roaring_t * roaring, uint32_t value);
+int roaring_remove(roaring_t * roaring, uint32_t value);
+bool roaring_contains(roaring_t * roaring, uint32_t value);
+uint64_t roaring_get_cardinality(roaring_t * roaring);
+// Number of values less than or equal to value
+uint64_t roaring_rank(roaring_t * roaring, uint32_t value);
+void roaring_iterate(roaring_t * roaring, roaring_visit_f visit, void * arg);
+roaring_t * roaring_union(roaring_t * roaring1, roaring_t * roaring2);
+roaring_t * roaring_intersection(roaring_t * roaring1, roaring_t * roaring2);
+// Switch chunks to run lists where that is smaller, adding or removing undoes it per chunk
+int roaring_run_optimize(roaring_t * roaring);
+// Portable little endian format, serialize returns 0 when the buffer is too small
+size_t roaring_serialized_size(roaring_t * roaring);
+size_t roaring_serialize(roaring_t * roaring, void * buffer, size_t size);
+roaring_t * roaring_deserialize(const void * buffer, size_t size);
+
+#endif
\ No newline at end of file
@@ -1,15 +1,42 @@
 #include <set.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#define MIN_HASH_SZ 8
+
+// Hashed sets keep the mixed hash next to the data so probes rarely call compare
+typedef struct slot
+{
+    void * data;
+    size_t hash;
+} slot_t;
 
 struct set
 {
+    // Linear and sorted sets keep their data packed at the front of array
     void ** array;
+    // Hashed sets use open addressing with linear probing, size is a power of two
+    slot_t * slots;
     size_t size;
     size_t filled;
     compare_f compare;
+    hash_f hash;
+    bool sorted;
 };
 
+static bool find_slot(set_t * set, void * data, size_t hash, size_t * idx);
+static bool find_index(set_t * set, void * data, size_t * idx);
+static void * find_element(set_t * set, void * data);
+static void * next_element(set_t * set, size_t * cursor);
+static int add_all(set_t * result, set_t * set);
+static set_t * create_like(set_t * set, size_t size);
+static bool sorted_pair(set_t * set1, set_t * set2);
+static size_t gallop(set_t * set, size_t low, void * data);
+static int grow_set(set_t * set);
+static size_t mix_hash(size_t hash);
+
 set_t * set_create(size_t size, compare_f compare)
 {
     if ((0 == size) || (NULL == compare))
@@ -35,24 +62,72 @@ set_t * set_create(size_t size, compare_f compare)
     return set;
 }
 
-void set_destroy(set_t * set, destroy_f destroy)
+set_t * set_create_hash(size_t size, compare_f compare, hash_f hash)
 {
-    if (NULL == set)
+    if ((NULL == compare) || (NULL == hash))
     {
-        return;
+        return NULL;
     }
 
-    if (NULL == set->array)
+    set_t * set = calloc(1, sizeof(*set));
+
+    if (set != NULL)
+    {
+        // Room for size elements without crossing the 3/4 load limit
+        set->size = MIN_HASH_SZ;
+        while ((set->size / 4) * 3 < size)
+        {
+            set->size *= 2;
+        }
+
+        set->compare = compare;
+        set->hash = hash;
+        set->slots = calloc(set->size, sizeof(slot_t));
+
+        if (NULL == set->slots)
+        {
+            free(set);
+            set = NULL;
+        }
+    }
+
+    return set;
+}
+
+set_t * set_create_sorted(size_t size, compare_f compare)
+{
+    set_t * set = set_create(size, compare);
+
+    if (set != NULL)
+    {
+        set->sorted = true;
+    }
+
+    return set;
+}
+
+void set_destroy(set_t * set, destroy_f destroy)
+{
+    if (NULL == set)
     {
-        free(set);
         return;
     }
 
     if (destroy != NULL)
     {
-        for (size_t i = 0; i < set->size; i++)
+        if (set->hash != NULL)
+        {
+            for (size_t i = 0; i < set->size; i++)
+            {
+                if (set->slots[i].data != NULL)
+                {
+                    destroy(set->slots[i].data);
+                }
+            }
+        }
+        else
         {
-            if (set->array[i] != NULL)
+            for (size_t i = 0; i < set->filled; i++)
             {
                 destroy(set->array[i]);
             }
@@ -60,6 +135,7 @@ void set_destroy(set_t * set, destroy_f destroy)
     }
 
     free(set->array);
+    free(set->slots);
     free(set);
 }
 
@@ -70,26 +146,45 @@ int set_add(set_t * set, void * data)
         return DATA_ERROR;
     }
 
-    bool contains = set_contains(set, data);
+    if (set->hash != NULL)
+    {
+        // Grow before probing so the slot found stays valid
+        if (((set->filled + 1) > (set->size / 4) * 3) && (grow_set(set) != OK))
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        size_t hash = mix_hash(set->hash(data));
+        size_t idx = 0;
+
+        if (find_slot(set, data, hash, &idx))
+        {
+            return KEY_EXISTS;
+        }
+
+        set->slots[idx].data = data;
+        set->slots[idx].hash = hash;
+        set->filled++;
+        return OK;
+    }
+
+    size_t idx = 0;
 
-    if (true == contains)
+    if (find_index(set, data, &idx))
     {
         return KEY_EXISTS;
     }
 
-    int return_value = STRUCTURE_FULL;
-    for (size_t i = 0; i < set->size; i++)
+    if ((set->filled == set->size) && (grow_set(set) != OK))
     {
-        if (NULL == set->array[i])
-        {
-            set->array[i] = data;
-            return_value = OK;
-            set->filled++;
-            break;
-        }
+        return ALLOCATION_ERROR;
     }
 
-    return return_value;
+    // Sorted sets open a gap at the lower bound, linear sets append
+    memmove(&(set->array[idx + 1]), &(set->array[idx]), (set->filled - idx) * sizeof(void *));
+    set->array[idx] = data;
+    set->filled++;
+    return OK;
 }
 
 void * set_remove(set_t * set, void * data)
@@ -99,58 +194,459 @@ void * set_remove(set_t * set, void * data)
         return NULL;
     }
 
-    void * return_value = NULL;
-    for (size_t i = 0; i < set->size; i++)
+    if (NULL == set->hash)
     {
-        if (NULL == set->array[i])
+        size_t idx = 0;
+
+        if (!find_index(set, data, &idx))
+        {
+            return NULL;
+        }
+
+        void * return_value = set->array[idx];
+        set->filled--;
+
+        if (set->sorted)
+        {
+            memmove(&(set->array[idx]), &(set->array[idx + 1]), (set->filled - idx) * sizeof(void *));
+        }
+        else
         {
-            continue;
+            // Order doesn't matter, fill the hole with the last element
+            set->array[idx] = set->array[set->filled];
         }
 
-        int comparison = set->compare(data, set->array[i]);
-        if (comparison == 0)
+        set->array[set->filled] = NULL;
+        return return_value;
+    }
+
+    size_t hole = 0;
+
+    if (!find_slot(set, data, mix_hash(set->hash(data)), &hole))
+    {
+        return NULL;
+    }
+
+    void * return_value = set->slots[hole].data;
+
+    // Shift back every following entry that may sit in the hole, so no tombstones are needed
+    size_t mask = set->size - 1;
+    size_t next = (hole + 1) & mask;
+    while (set->slots[next].data != NULL)
+    {
+        size_t home = set->slots[next].hash & mask;
+
+        if (((next - home) & mask) >= ((next - hole) & mask))
         {
-            return_value =  set->array[i];
-            set->array[i] = NULL;
-            set->filled--;
-            break;
+            set->slots[hole] = set->slots[next];
+            hole = next;
         }
+
+        next = (next + 1) & mask;
     }
 
+    set->slots[hole].data = NULL;
+    set->filled--;
     return return_value;
 }
 
 bool set_contains(set_t * set, void * data)
 {
     if ((NULL == set) || (NULL == data))
+    {
+        return false;
+    }
+
+    return find_element(set, data) != NULL;
+}
+
+size_t set_get_size(set_t * set)
+{
+    return (set != NULL) ? set->filled : 0;
+}
+
+set_t * set_union(set_t * set1, set_t * set2)
+{
+    if ((NULL == set1) || (NULL == set2))
+    {
+        return NULL;
+    }
+
+    set_t * result = create_like(set1, set1->filled + set2->filled);
+
+    if (NULL == result)
     {
         return NULL;
     }
 
-    bool return_value = false;
-    for (size_t i = 0; i < set->size; i++)
+    if (sorted_pair(set1, set2))
     {
-        if (NULL == set->array[i])
+        // Plain merge of the two arrays, result was sized so it never grows
+        size_t idx1 = 0;
+        size_t idx2 = 0;
+        while ((idx1 < set1->filled) && (idx2 < set2->filled))
         {
-            continue;
+            int comparison = set1->compare(set1->array[idx1], set2->array[idx2]);
+            result->array[result->filled++] = (comparison <= 0) ? set1->array[idx1] : set2->array[idx2];
+            idx1 += (comparison <= 0);
+            idx2 += (comparison >= 0);
         }
 
-        int comparison = set->compare(data, set->array[i]);
-        if (comparison == 0)
+        memcpy(&(result->array[result->filled]), &(set1->array[idx1]), (set1->filled - idx1) * sizeof(void *));
+        result->filled += set1->filled - idx1;
+        memcpy(&(result->array[result->filled]), &(set2->array[idx2]), (set2->filled - idx2) * sizeof(void *));
+        result->filled += set2->filled - idx2;
+        return result;
+    }
+
+    if ((add_all(result, set1) != OK) || (add_all(result, set2) != OK))
+    {
+        set_destroy(result, NULL);
+        result = NULL;
+    }
+
+    return result;
+}
+
+set_t * set_intersection(set_t * set1, set_t * set2)
+{
+    if ((NULL == set1) || (NULL == set2))
+    {
+        return NULL;
+    }
+
+    set_t * result = create_like(set1, (set1->filled < set2->filled) ? set1->filled : set2->filled);
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    if (sorted_pair(set1, set2))
+    {
+        // Gallop past runs that can't match, a small set against a large one costs O(m log(n / m))
+        size_t idx1 = 0;
+        size_t idx2 = 0;
+        while ((idx1 < set1->filled) && (idx2 < set2->filled))
+        {
+            int comparison = set1->compare(set1->array[idx1], set2->array[idx2]);
+
+            if (0 == comparison)
+            {
+                result->array[result->filled++] = set1->array[idx1];
+                idx1++;
+                idx2++;
+            }
+            else if (comparison < 0)
+            {
+                idx1 = gallop(set1, idx1 + 1, set2->array[idx2]);
+            }
+            else
+            {
+                idx2 = gallop(set2, idx2 + 1, set1->array[idx1]);
+            }
+        }
+
+        return result;
+    }
+
+    // Walk the smaller set and probe the larger, keeping set1's copy of each element
+    set_t * small = (set1->filled <= set2->filled) ? set1 : set2;
+    set_t * large = (small == set1) ? set2 : set1;
+    size_t cursor = 0;
+    void * data = NULL;
+    int result_value = OK;
+    while ((OK == result_value) && (NULL != (data = next_element(small, &cursor))))
+    {
+        void * match = find_element(large, data);
+
+        if (match != NULL)
         {
-            return_value =  true;
-            break;
+            result_value = set_add(result, (small == set1) ? data : match);
         }
     }
 
-    return return_value;
+    if (result_value != OK)
+    {
+        set_destroy(result, NULL);
+        result = NULL;
+    }
+
+    return result;
 }
 
-size_t set_get_size(set_t * set)
+set_t * set_difference(set_t * set1, set_t * set2)
 {
-    if (set != NULL)
+    if ((NULL == set1) || (NULL == set2))
     {
-        return set->filled;
+        return NULL;
     }
+
+    set_t * result = create_like(set1, set1->filled);
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    if (sorted_pair(set1, set2))
+    {
+        size_t idx1 = 0;
+        size_t idx2 = 0;
+        while ((idx1 < set1->filled) && (idx2 < set2->filled))
+        {
+            idx2 = gallop(set2, idx2, set1->array[idx1]);
+
+            if ((idx2 == set2->filled) || (set1->compare(set1->array[idx1], set2->array[idx2]) != 0))
+            {
+                result->array[result->filled++] = set1->array[idx1];
+            }
+
+            idx1++;
+        }
+
+        // Nothing left in set2 to remove, keep the rest of set1
+        memcpy(&(result->array[result->filled]), &(set1->array[idx1]), (set1->filled - idx1) * sizeof(void *));
+        result->filled += set1->filled - idx1;
+        return result;
+    }
+
+    size_t cursor = 0;
+    void * data = NULL;
+    int result_value = OK;
+    while ((OK == result_value) && (NULL != (data = next_element(set1, &cursor))))
+    {
+        if (NULL == find_element(set2, data))
+        {
+            result_value = set_add(result, data);
+        }
+    }
+
+    if (result_value != OK)
+    {
+        set_destroy(result, NULL);
+        result = NULL;
+    }
+
+    return result;
+}
+
+static bool find_slot(set_t * set, void * data, size_t hash, size_t * idx)
+{
+    // Stops on a match or the first empty slot, which is where data would go
+    size_t mask = set->size - 1;
+    size_t probe = hash & mask;
+    while (set->slots[probe].data != NULL)
+    {
+        if ((set->slots[probe].hash == hash) && (0 == set->compare(data, set->slots[probe].data)))
+        {
+            *idx = probe;
+            return true;
+        }
+
+        probe = (probe + 1) & mask;
+    }
+
+    *idx = probe;
+    return false;
+}
+
+static bool find_index(set_t * set, void * data, size_t * idx)
+{
+    if (set->sorted)
+    {
+        // Binary search for the lower bound, which is also where data would be inserted
+        size_t low = 0;
+        size_t high = set->filled;
+        while (low < high)
+        {
+            size_t mid = low + ((high - low) / 2);
+
+            if (set->compare(set->array[mid], data) < 0)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        *idx = low;
+        return (low < set->filled) && (0 == set->compare(set->array[low], data));
+    }
+
+    // Only the filled part of a linear set is scanned
+    for (size_t i = 0; i < set->filled; i++)
+    {
+        if (0 == set->compare(data, set->array[i]))
+        {
+            *idx = i;
+            return true;
+        }
+    }
+
+    *idx = set->filled;
+    return false;
+}
+
+static void * find_element(set_t * set, void * data)
+{
+    size_t idx = 0;
+
+    if (set->hash != NULL)
+    {
+        return find_slot(set, data, mix_hash(set->hash(data)), &idx) ? set->slots[idx].data : NULL;
+    }
+
+    return find_index(set, data, &idx) ? set->array[idx] : NULL;
+}
+
+static void * next_element(set_t * set, size_t * cursor)
+{
+    if (NULL == set->hash)
+    {
+        return (*cursor < set->filled) ? set->array[(*cursor)++] : NULL;
+    }
+
+    while (*cursor < set->size)
+    {
+        void * data = set->slots[(*cursor)++].data;
+
+        if (data != NULL)
+        {
+            return data;
+        }
+    }
+
+    return NULL;
+}
+
+static int add_all(set_t * result, set_t * set)
+{
+    size_t cursor = 0;
+    void * data = NULL;
+    while (NULL != (data = next_element(set, &cursor)))
+    {
+        int result_value = set_add(result, data);
+
+        if ((result_value != OK) && (result_value != KEY_EXISTS))
+        {
+            return result_value;
+        }
+    }
+
+    return OK;
+}
+
+static set_t * create_like(set_t * set, size_t size)
+{
+    if (set->hash != NULL)
+    {
+        return set_create_hash(size, set->compare, set->hash);
+    }
+
+    // Array sets need at least one slot
+    set_t * result = set_create((0 == size) ? 1 : size, set->compare);
+
+    if (result != NULL)
+    {
+        result->sorted = set->sorted;
+    }
+
+    return result;
+}
+
+static bool sorted_pair(set_t * set1, set_t * set2)
+{
+    // Merging needs both arrays in the same order
+    return set1->sorted && set2->sorted && (set1->compare == set2->compare);
+}
+
+static size_t gallop(set_t * set, size_t low, void * data)
+{
+    // Lower bound of data at or after low, doubling the step before a binary search
+    size_t high = low;
+    size_t step = 1;
+    while ((high < set->filled) && (set->compare(set->array[high], data) < 0))
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+
+    high = (high < set->filled) ? high : set->filled;
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+
+        if (set->compare(set->array[mid], data) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static int grow_set(set_t * set)
+{
+    if (NULL == set->hash)
+    {
+        void ** array = realloc(set->array, set->size * 2 * sizeof(void *));
+
+        if (NULL == array)
+        {
+            return ALLOCATION_ERROR;
+        }
+
+        set->array = array;
+        set->size *= 2;
+        return OK;
+    }
+
+    slot_t * old_slots = set->slots;
+    size_t old_size = set->size;
+    set->slots = calloc(old_size * 2, sizeof(slot_t));
+
+    if (NULL == set->slots)
+    {
+        set->slots = old_slots;
+        return ALLOCATION_ERROR;
+    }
+
+    // Rehash with the stored hashes, compare is never called since every entry is unique
+    set->size = old_size * 2;
+    size_t mask = set->size - 1;
+    for (size_t i = 0; i < old_size; i++)
+    {
+        if (old_slots[i].data != NULL)
+        {
+            size_t probe = old_slots[i].hash & mask;
+            while (set->slots[probe].data != NULL)
+            {
+                probe = (probe + 1) & mask;
+            }
+
+            set->slots[probe] = old_slots[i];
+        }
+    }
+
+    free(old_slots);
+    return OK;
+}
+
+static size_t mix_hash(size_t hash)
+{
+    // Spread weak hashes such as aligned pointers or small integers over the low bits
+    uint64_t mixed = (uint64_t)hash;
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdull;
+    mixed ^= mixed >> 33;
+    return (size_t)mixed;
 }
 // END OF SOURCE
\ No newline at end of file
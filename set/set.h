@@ -8,10 +8,19 @@
 typedef struct set set_t;
 
 set_t * set_create(size_t size, compare_f compare);
+// Hashed set, equal elements must hash the same and operations are O(1) expected
+set_t * set_create_hash(size_t size, compare_f compare, hash_f hash);
+// Sorted flat array, compare must order elements. O(log n) lookups and fast set algebra.
+set_t * set_create_sorted(size_t size, compare_f compare);
 void set_destroy(set_t * set, destroy_f destroy);
 int set_add(set_t * set, void * data);
 void * set_remove(set_t * set, void * data);
 bool set_contains(set_t * set, void * data);
 size_t set_get_size(set_t * set);
+// New sets of the same kind as set1, equal elements are taken from set1.
+// Elements are shared with the inputs, destroy the results with a NULL destroy.
+set_t * set_union(set_t * set1, set_t * set2);
+set_t * set_intersection(set_t * set1, set_t * set2);
+set_t * set_difference(set_t * set1, set_t * set2);
 
 #endif
\ No newline at end of file
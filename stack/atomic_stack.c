@@ -0,0 +1,334 @@
+#include <atomic_stack.h>
+#include <dstruct_random.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NIL_IDX UINT32_MAX
+#define ELIMINATION_SZ 16
+#define ELIMINATION_SPINS 128
+#define SLOT_EMPTY 0
+#define SLOT_TAKEN UINT32_MAX
+
+// A list head packs a 32 bit modification tag above a 32 bit node index.
+// Every successful CAS bumps the tag so a stale head can never compare equal.
+#define HEAD_IDX(head) ((uint32_t)(head))
+#define HEAD_TAG(head) ((uint32_t)((head) >> 32))
+#define HEAD_PACK(tag, idx) (((uint64_t)(tag) << 32) | (uint32_t)(idx))
+
+typedef struct node_ {
+    void * data;
+    _Atomic uint32_t next;
+} node_t;
+
+struct atomic_stack_ {
+    _Atomic uint64_t head;
+    _Atomic uint64_t free_head;
+    node_t * nodes;
+    size_t size;
+    destroy_f destroy;
+    bool elimination;
+    // Slots hold node index + 1 while a push is offered to a waiting pop
+    _Atomic uint32_t slots[ELIMINATION_SZ];
+};
+
+static uint32_t list_pop(atomic_stack_t * stack, _Atomic uint64_t * head);
+static void list_push(atomic_stack_t * stack, _Atomic uint64_t * head, uint32_t first, uint32_t last);
+static bool eliminate_push(atomic_stack_t * stack, uint32_t idx);
+static uint32_t eliminate_pop(atomic_stack_t * stack);
+
+atomic_stack_t * atomic_stack_create(size_t size, destroy_f destroy, bool elimination)
+{
+    if ((0 == size) || (size >= NIL_IDX))
+    {
+        return NULL;
+    }
+
+    atomic_stack_t * stack = calloc(1, sizeof(*stack));
+
+    if (NULL == stack)
+    {
+        return NULL;
+    }
+
+    stack->nodes = calloc(size, sizeof(*(stack->nodes)));
+
+    if (NULL == stack->nodes)
+    {
+        free(stack);
+        return NULL;
+    }
+
+    stack->size = size;
+    stack->destroy = destroy;
+    stack->elimination = elimination;
+
+    // Chain every node of the pool onto the free list
+    for (size_t i = 0; i < size; i++)
+    {
+        uint32_t next = (i + 1 < size) ? (uint32_t)(i + 1) : NIL_IDX;
+        atomic_init(&(stack->nodes[i].next), next);
+    }
+
+    atomic_init(&(stack->head), HEAD_PACK(0, NIL_IDX));
+    atomic_init(&(stack->free_head), HEAD_PACK(0, 0));
+
+    for (size_t i = 0; i < ELIMINATION_SZ; i++)
+    {
+        atomic_init(&(stack->slots[i]), SLOT_EMPTY);
+    }
+
+    return stack;
+}
+
+void atomic_stack_destroy(atomic_stack_t * stack)
+{
+    // Not safe to call while other threads are still using the stack
+    if (NULL == stack)
+    {
+        return;
+    }
+
+    if (stack->destroy != NULL)
+    {
+        uint32_t idx = HEAD_IDX(atomic_load(&(stack->head)));
+        while (idx != NIL_IDX)
+        {
+            stack->destroy(stack->nodes[idx].data);
+            idx = atomic_load(&(stack->nodes[idx].next));
+        }
+    }
+
+    free(stack->nodes);
+    free(stack);
+}
+
+int atomic_stack_push(atomic_stack_t * stack, void * data)
+{
+    if (NULL == stack)
+    {
+        return STRUCTURE_NULL;
+    }
+    else if (NULL == data)
+    {
+        return DATA_NULL;
+    }
+
+    // Take a node from the pool to hold the data
+    uint32_t idx = list_pop(stack, &(stack->free_head));
+
+    if (NIL_IDX == idx)
+    {
+        return STRUCTURE_FULL;
+    }
+
+    stack->nodes[idx].data = data;
+
+    uint64_t old_head = atomic_load_explicit(&(stack->head), memory_order_relaxed);
+    for (;;)
+    {
+        atomic_store_explicit(&(stack->nodes[idx].next), HEAD_IDX(old_head), memory_order_relaxed);
+        uint64_t new_head = HEAD_PACK(HEAD_TAG(old_head) + 1, idx);
+
+        if (atomic_compare_exchange_weak_explicit(&(stack->head), &old_head, new_head,
+                                                  memory_order_release, memory_order_relaxed))
+        {
+            break;
+        }
+
+        if (stack->elimination && eliminate_push(stack, idx))
+        {
+            // A concurrent pop took the node straight from the elimination array
+            break;
+        }
+
+        old_head = atomic_load_explicit(&(stack->head), memory_order_relaxed);
+    }
+
+    return OK;
+}
+
+void * atomic_stack_pop(atomic_stack_t * stack)
+{
+    if (NULL == stack)
+    {
+        return NULL;
+    }
+
+    uint64_t old_head = atomic_load_explicit(&(stack->head), memory_order_acquire);
+    uint32_t idx = NIL_IDX;
+    for (;;)
+    {
+        idx = HEAD_IDX(old_head);
+
+        if (NIL_IDX == idx)
+        {
+            // Stack is empty
+            return NULL;
+        }
+
+        // The node may be popped and reused under us, the tag makes the CAS fail if so
+        uint32_t next = atomic_load_explicit(&(stack->nodes[idx].next), memory_order_relaxed);
+        uint64_t new_head = HEAD_PACK(HEAD_TAG(old_head) + 1, next);
+
+        if (atomic_compare_exchange_weak_explicit(&(stack->head), &old_head, new_head,
+                                                  memory_order_acquire, memory_order_acquire))
+        {
+            break;
+        }
+
+        if (stack->elimination)
+        {
+            uint32_t eliminated = eliminate_pop(stack);
+
+            if (eliminated != NIL_IDX)
+            {
+                idx = eliminated;
+                break;
+            }
+
+            old_head = atomic_load_explicit(&(stack->head), memory_order_acquire);
+        }
+    }
+
+    void * data = stack->nodes[idx].data;
+    // Hand the node back to the pool
+    list_push(stack, &(stack->free_head), idx, idx);
+    return data;
+}
+
+size_t atomic_stack_pop_all(atomic_stack_t * stack, visit_f visit, void * arg)
+{
+    if (NULL == stack)
+    {
+        return 0;
+    }
+
+    // Detach the whole chain with a single exchange, it is private to this thread afterwards
+    uint64_t old_head = atomic_load_explicit(&(stack->head), memory_order_relaxed);
+    uint64_t new_head = 0;
+    do
+    {
+        new_head = HEAD_PACK(HEAD_TAG(old_head) + 1, NIL_IDX);
+    } while (!atomic_compare_exchange_weak_explicit(&(stack->head), &old_head, new_head,
+                                                    memory_order_acquire, memory_order_relaxed));
+
+    uint32_t first = HEAD_IDX(old_head);
+    uint32_t last = first;
+    size_t count = 0;
+    for (uint32_t idx = first; idx != NIL_IDX;)
+    {
+        if (visit != NULL)
+        {
+            visit(stack->nodes[idx].data, arg);
+        }
+
+        count++;
+        last = idx;
+        idx = atomic_load_explicit(&(stack->nodes[idx].next), memory_order_relaxed);
+    }
+
+    if (first != NIL_IDX)
+    {
+        // Splice the detached chain onto the free list in one step
+        list_push(stack, &(stack->free_head), first, last);
+    }
+
+    return count;
+}
+
+static uint32_t list_pop(atomic_stack_t * stack, _Atomic uint64_t * head)
+{
+    uint64_t old_head = atomic_load_explicit(head, memory_order_acquire);
+    for (;;)
+    {
+        uint32_t idx = HEAD_IDX(old_head);
+
+        if (NIL_IDX == idx)
+        {
+            return NIL_IDX;
+        }
+
+        uint32_t next = atomic_load_explicit(&(stack->nodes[idx].next), memory_order_relaxed);
+        uint64_t new_head = HEAD_PACK(HEAD_TAG(old_head) + 1, next);
+
+        if (atomic_compare_exchange_weak_explicit(head, &old_head, new_head,
+                                                  memory_order_acquire, memory_order_acquire))
+        {
+            return idx;
+        }
+    }
+}
+
+static void list_push(atomic_stack_t * stack, _Atomic uint64_t * head, uint32_t first, uint32_t last)
+{
+    // Push the already linked chain first..last on to the list
+    uint64_t old_head = atomic_load_explicit(head, memory_order_relaxed);
+    for (;;)
+    {
+        atomic_store_explicit(&(stack->nodes[last].next), HEAD_IDX(old_head), memory_order_relaxed);
+        uint64_t new_head = HEAD_PACK(HEAD_TAG(old_head) + 1, first);
+
+        if (atomic_compare_exchange_weak_explicit(head, &old_head, new_head,
+                                                  memory_order_release, memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+static bool eliminate_push(atomic_stack_t * stack, uint32_t idx)
+{
+    // Offer the node in a random slot and wait a short while for a pop to take it
+    _Atomic uint32_t * slot = &(stack->slots[dstruct_random() % ELIMINATION_SZ]);
+    uint32_t expected = SLOT_EMPTY;
+
+    if (!atomic_compare_exchange_strong_explicit(slot, &expected, idx + 1,
+                                                 memory_order_release, memory_order_relaxed))
+    {
+        // Slot already in use
+        return false;
+    }
+
+    for (int i = 0; i < ELIMINATION_SPINS; i++)
+    {
+        if (atomic_load_explicit(slot, memory_order_acquire) == SLOT_TAKEN)
+        {
+            atomic_store_explicit(slot, SLOT_EMPTY, memory_order_release);
+            return true;
+        }
+    }
+
+    // Nobody came, try to withdraw the offer
+    expected = idx + 1;
+    if (atomic_compare_exchange_strong_explicit(slot, &expected, SLOT_EMPTY,
+                                                memory_order_acquire, memory_order_acquire))
+    {
+        return false;
+    }
+
+    // A pop took the node while we were withdrawing
+    atomic_store_explicit(slot, SLOT_EMPTY, memory_order_release);
+    return true;
+}
+
+static uint32_t eliminate_pop(atomic_stack_t * stack)
+{
+    _Atomic uint32_t * slot = &(stack->slots[dstruct_random() % ELIMINATION_SZ]);
+    uint32_t value = atomic_load_explicit(slot, memory_order_relaxed);
+
+    if ((SLOT_EMPTY == value) || (SLOT_TAKEN == value))
+    {
+        // No push waiting in this slot
+        return NIL_IDX;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(slot, &value, SLOT_TAKEN,
+                                                memory_order_acquire, memory_order_relaxed))
+    {
+        return value - 1;
+    }
+
+    return NIL_IDX;
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef _ATOMIC_STACK_H_
+#define _ATOMIC_STACK_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <dstruct_funcs.h>
+
+// Lock-free LIFO stack safe to share between threads without a lock.
+// Nodes come from a fixed pool sized at creation and are never handed back
+// to the allocator while the stack is alive, the head is tagged to prevent ABA.
+typedef struct atomic_stack_ atomic_stack_t;
+
+atomic_stack_t * atomic_stack_create(size_t size, destroy_f destroy, bool elimination);
+void atomic_stack_destroy(atomic_stack_t * stack);
+int atomic_stack_push(atomic_stack_t * stack, void * data);
+void * atomic_stack_pop(atomic_stack_t * stack);
+size_t atomic_stack_pop_all(atomic_stack_t * stack, visit_f visit, void * arg);
+
+#endif
@@ -1,15 +1,20 @@
 #include <stack.h>
-#include <circular_ll.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 
 struct stack_ {
-    circular_list_t * list;
+    void ** array;
     size_t size;
     size_t filled;
+    compare_f compare;
+    destroy_f destroy;
+    void * inline_array[STACK_INLINE_SZ];
 };
 
+static int resize_array(stack_t * stack, size_t size);
+
 stack_t * stack_create(compare_f compare, destroy_f destroy)
 {
     stack_t * stack = calloc(sizeof(*stack), 1);
@@ -21,8 +26,11 @@ stack_t * stack_create(compare_f compare, destroy_f destroy)
     }
     else
     {
-        // Call circular linked list function to create list
-        stack->list = circular_create(compare, destroy);
+        // Start out using the inline array, no allocation needed for small stacks
+        stack->array = stack->inline_array;
+        stack->size = STACK_INLINE_SZ;
+        stack->compare = compare;
+        stack->destroy = destroy;
     }
 
     return stack;
@@ -30,7 +38,7 @@ stack_t * stack_create(compare_f compare, destroy_f destroy)
 
 stack_t * stack_create_n(compare_f compare, destroy_f destroy, size_t size)
 {
-    stack_t * stack = calloc(1, sizeof(*stack));
+    stack_t * stack = stack_create(compare, destroy);
 
     if (NULL == stack)
     {
@@ -38,73 +46,58 @@ stack_t * stack_create_n(compare_f compare, destroy_f destroy, size_t size)
         return NULL;
     }
 
-    stack->list = circular_create(compare, destroy);
-
-    if (NULL == stack->list)
+    if (stack_reserve(stack, size) != OK)
     {
-        // Memory allocation failed for stack's linked list
-        free(stack);
+        // Memory allocation failed for stack's array
+        stack_destroy(stack);
         return NULL;
     }
 
-    for (size_t i = 0; i < size; i++)
-    {
-        // Insert NULL data into the linked list as a placeholder for data later
-        void * tmp_ptr = NULL;
-        stack->size = circular_insert(stack->list, tmp_ptr, FRONT);
-    }
-
     return stack;
 }
 
 void stack_destroy(stack_t * stack)
 {
-    if (stack && stack->list)
+    if (NULL == stack)
     {
+        return;
+    }
 
-        if (stack->list)
+    if (stack->destroy != NULL)
+    {
+        // Destroy function registered, call on all data still inside of the stack
+        for (size_t i = 0; i < stack->filled; i++)
         {
-            circular_destroy(stack->list);
+            stack->destroy(stack->array[i]);
         }
+    }
 
-        free(stack);
+    if (stack->array != stack->inline_array)
+    {
+        free(stack->array);
     }
+
+    free(stack);
 }
 
 size_t stack_push(stack_t * stack, void * data)
 {
-    if ((NULL == stack) || (NULL == stack->list))
+    if ((NULL == stack) || (NULL == data))
     {
-        return 0;
+        return (stack != NULL) ? stack->filled : 0;
     }
 
-    // Check to see if the size of the linked list equals the amount filled in the stack
-    if (stack->size == stack->filled)
+    if (stack->filled == stack->size)
     {
-        // Linked list size is equal to the amount filled in the stack
-        // This means there are no longer any place holders left in the linked list
-        // Insert new node into linked list
-        int tmp_size = circular_insert(stack->list, data, FRONT);
-
-        if (stack->size < tmp_size)
+        // Array is full, grow geometrically so pushes stay amortized O(1)
+        if (resize_array(stack, stack->size * 2) != OK)
         {
-            // Insert succeeded if the tmp_size is greater than the stack size
-            stack->size++;
-            stack->filled++;
+            return stack->filled;
         }
-
-    }
-    else
-    {
-        // Linked list size is not equal to the amount filled in the stack
-        // This means there are placeholders available in the linked list
-        // Update a placeholder to hold data instead of insert into linked list 
-        size_t node_index = stack->size - stack->filled - 1;
-        circular_update_nth(stack->list, node_index, data);
-        // Update the amount filled in the stack
-        stack->filled++;
     }
 
+    stack->array[stack->filled] = data;
+    stack->filled++;
     return stack->filled;
 }
 
@@ -112,10 +105,10 @@ void * stack_pop(stack_t * stack)
 {
     void * data = NULL;
 
-    if (stack && stack->list)
+    if ((stack != NULL) && (stack->filled != 0))
     {
-        data = circular_remove_at(stack->list, FRONT);
-        stack->size--;
+        stack->filled--;
+        data = stack->array[stack->filled];
     }
 
     return data;
@@ -124,9 +117,10 @@ void * stack_pop(stack_t * stack)
 void * stack_find_nth(stack_t * stack, size_t idx)
 {
     void * return_data = NULL;
-    if ((stack != NULL) && (stack->list != NULL) && (idx < stack->size))
+    if ((stack != NULL) && (idx < stack->filled))
     {
-        return_data = circular_get_data(stack->list, idx);
+        // Index 0 is the top of the stack, the last element in the array
+        return_data = stack->array[stack->filled - idx - 1];
     }
 
     return return_data;
@@ -134,6 +128,81 @@ void * stack_find_nth(stack_t * stack, size_t idx)
 
 size_t stack_get_size(stack_t * stack)
 {
-    return (stack != NULL) ? stack->size : 0;
+    return (stack != NULL) ? stack->filled : 0;
+}
+
+int stack_reserve(stack_t * stack, size_t size)
+{
+    if (NULL == stack)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    if (size <= stack->size)
+    {
+        // Already have enough room
+        return OK;
+    }
+
+    return resize_array(stack, size);
+}
+
+int stack_shrink(stack_t * stack)
+{
+    if (NULL == stack)
+    {
+        return STRUCTURE_NULL;
+    }
+
+    if (stack->array == stack->inline_array)
+    {
+        // Inline array can not be made any smaller
+        return OK;
+    }
+
+    return resize_array(stack, stack->filled);
+}
+
+static int resize_array(stack_t * stack, size_t size)
+{
+    if (size <= STACK_INLINE_SZ)
+    {
+        // Everything fits in the inline array, release the heap array if there is one
+        if (stack->array != stack->inline_array)
+        {
+            memcpy(stack->inline_array, stack->array, stack->filled * sizeof(void *));
+            free(stack->array);
+            stack->array = stack->inline_array;
+            stack->size = STACK_INLINE_SZ;
+        }
+
+        return OK;
+    }
+
+    void ** new_array = NULL;
+    if (stack->array == stack->inline_array)
+    {
+        // Moving off of the inline array for the first time
+        new_array = malloc(size * sizeof(void *));
+
+        if (new_array != NULL)
+        {
+            memcpy(new_array, stack->inline_array, stack->filled * sizeof(void *));
+        }
+    }
+    else
+    {
+        new_array = realloc(stack->array, size * sizeof(void *));
+    }
+
+    if (NULL == new_array)
+    {
+        // Old array is left untouched on failure
+        return ALLOCATION_ERROR;
+    }
+
+    stack->array = new_array;
+    stack->size = size;
+    return OK;
 }
 // END OF SOURCE
\ No newline at end of file
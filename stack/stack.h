@@ -4,6 +4,9 @@
 #include <stddef.h>
 #include <dstruct_funcs.h>
 
+// Number of slots stored inside the stack itself before any heap allocation
+#define STACK_INLINE_SZ 16
+
 typedef struct stack_ stack_t;
 
 stack_t * stack_create(compare_f compare, destroy_f destroy);
@@ -13,5 +16,7 @@ size_t stack_push(stack_t * p_stack, void * p_data);
 void * stack_pop(stack_t * p_stack);
 void * stack_find_nth(stack_t * stack, size_t idx);
 size_t stack_get_size(stack_t * stack);
+int stack_reserve(stack_t * stack, size_t size);
+int stack_shrink(stack_t * stack);
 
 #endif
@@ -0,0 +1,480 @@
+#include <timer_wheel.h>
+#include <heap.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Four levels of 256 slots cover 2^32 ticks, anything further out waits in the overflow heap
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+#define WHEEL_WORDS (WHEEL_SLOTS / 64)
+#define WHEEL_RANGE_BITS (WHEEL_BITS * WHEEL_LEVELS)
+#define BLOCK_SZ 1024
+#define HEAP_START_SZ 16
+
+// Location of a timer, values below LOCATION_DUE are level * WHEEL_SLOTS + slot
+enum {LOCATION_DUE = WHEEL_LEVELS * WHEEL_SLOTS, LOCATION_OVERFLOW, LOCATION_EXPIRING, LOCATION_FREE};
+
+typedef struct link
+{
+    struct link * next;
+    struct link * prev;
+} link_t;
+
+struct wheel_timer
+{
+    // Must stay the first member, list links are cast back to timers
+    link_t link;
+    uint64_t deadline;
+    void * data;
+    heap_handle_t * handle;
+    uint32_t location;
+};
+
+// Timers are carved out of blocks and recycled, never freed one at a time
+typedef struct block
+{
+    struct block * next;
+    wheel_timer_t timers[BLOCK_SZ];
+} block_t;
+
+struct timer_wheel
+{
+    link_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    // Bit set for every slot that holds timers
+    uint64_t used[WHEEL_LEVELS][WHEEL_WORDS];
+    // Timers whose deadline had already passed when scheduled
+    link_t due;
+    // Timers being handed to the expire callback
+    link_t expiring;
+    heap_t * overflow;
+    block_t * blocks;
+    wheel_timer_t * free_timers;
+    uint64_t current;
+    size_t filled;
+};
+
+static void list_init(link_t * head);
+static void list_append(link_t * head, link_t * link);
+static void list_remove(link_t * link);
+static void list_splice(link_t * head, link_t * other);
+static bool list_empty(link_t * head);
+static int place_timer(timer_wheel_t * wheel, wheel_timer_t * timer);
+static void unlink_timer(timer_wheel_t * wheel, wheel_timer_t * timer);
+static bool next_event(timer_wheel_t * wheel, uint64_t * tick);
+static void process_tick(timer_wheel_t * wheel, uint64_t tick);
+static void cascade(timer_wheel_t * wheel, size_t level, size_t slot);
+static size_t fire_expired(timer_wheel_t * wheel, visit_f expire, void * arg);
+static wheel_timer_t * allocate_timer(timer_wheel_t * wheel);
+static void release_timer(timer_wheel_t * wheel, wheel_timer_t * timer);
+static size_t get_digit(uint64_t tick, size_t level);
+static int compare_deadlines(const void * arg1, const void * arg2);
+
+timer_wheel_t * timer_wheel_create(uint64_t now)
+{
+    timer_wheel_t * wheel = calloc(1, sizeof(*wheel));
+
+    if (NULL == wheel)
+    {
+        return NULL;
+    }
+
+    wheel->overflow = heap_create(HEAP_START_SZ, compare_deadlines);
+
+    if (NULL == wheel->overflow)
+    {
+        free(wheel);
+        return NULL;
+    }
+
+    for (size_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (size_t slot = 0; slot < WHEEL_SLOTS; slot++)
+        {
+            list_init(&(wheel->slots[level][slot]));
+        }
+    }
+
+    list_init(&(wheel->due));
+    list_init(&(wheel->expiring));
+    wheel->current = now;
+    return wheel;
+}
+
+void timer_wheel_destroy(timer_wheel_t * wheel, destroy_f destroy_data)
+{
+    if (NULL == wheel)
+    {
+        return;
+    }
+
+    if (destroy_data != NULL)
+    {
+        // Every timer still scheduled lives in one of the blocks
+        for (block_t * block = wheel->blocks; block != NULL; block = block->next)
+        {
+            for (size_t i = 0; i < BLOCK_SZ; i++)
+            {
+                if (block->timers[i].location != LOCATION_FREE)
+                {
+                    destroy_data(block->timers[i].data);
+                }
+            }
+        }
+    }
+
+    // Timers in the overflow heap are freed along with their blocks
+    while (heap_get_size(wheel->overflow) != 0)
+    {
+        heap_extract(wheel->overflow, NULL);
+    }
+
+    heap_destroy(wheel->overflow, NULL, NULL);
+
+    block_t * block = wheel->blocks;
+    while (block != NULL)
+    {
+        block_t * next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(wheel);
+}
+
+wheel_timer_t * timer_wheel_schedule(timer_wheel_t * wheel, uint64_t deadline, void * data)
+{
+    if ((NULL == wheel) || (NULL == data))
+    {
+        return NULL;
+    }
+
+    wheel_timer_t * timer = allocate_timer(wheel);
+
+    if (NULL == timer)
+    {
+        return NULL;
+    }
+
+    timer->deadline = deadline;
+    timer->data = data;
+
+    if (place_timer(wheel, timer) != OK)
+    {
+        release_timer(wheel, timer);
+        return NULL;
+    }
+
+    wheel->filled++;
+    return timer;
+}
+
+void * timer_wheel_cancel(timer_wheel_t * wheel, wheel_timer_t * timer)
+{
+    if ((NULL == wheel) || (NULL == timer) || (LOCATION_FREE == timer->location))
+    {
+        return NULL;
+    }
+
+    unlink_timer(wheel, timer);
+    void * return_data = timer->data;
+    release_timer(wheel, timer);
+    wheel->filled--;
+    return return_data;
+}
+
+size_t timer_wheel_advance(timer_wheel_t * wheel, uint64_t now, visit_f expire, void * arg)
+{
+    if (NULL == wheel)
+    {
+        return 0;
+    }
+
+    // Anything scheduled in the past goes first
+    size_t count = fire_expired(wheel, expire, arg);
+
+    // Jump straight from one occupied slot to the next instead of walking every tick
+    uint64_t tick = 0;
+    while (next_event(wheel, &tick) && (tick <= now))
+    {
+        process_tick(wheel, tick);
+        count += fire_expired(wheel, expire, arg);
+    }
+
+    if (now > wheel->current)
+    {
+        wheel->current = now;
+    }
+
+    return count;
+}
+
+size_t timer_wheel_get_size(timer_wheel_t * wheel)
+{
+    return (wheel != NULL) ? wheel->filled : 0;
+}
+
+static void list_init(link_t * head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_append(link_t * head, link_t * link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void list_remove(link_t * link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+}
+
+static void list_splice(link_t * head, link_t * other)
+{
+    // Move every link of other to the back of head, other is left empty
+    if (list_empty(other))
+    {
+        return;
+    }
+
+    other->next->prev = head->prev;
+    head->prev->next = other->next;
+    other->prev->next = head;
+    head->prev = other->prev;
+    list_init(other);
+}
+
+static bool list_empty(link_t * head)
+{
+    return head->next == head;
+}
+
+static int place_timer(timer_wheel_t * wheel, wheel_timer_t * timer)
+{
+    if (timer->deadline <= wheel->current)
+    {
+        timer->location = LOCATION_DUE;
+        list_append(&(wheel->due), &(timer->link));
+        return OK;
+    }
+
+    // The level is picked by the highest 8 bit digit where the deadline differs from now
+    uint64_t difference = timer->deadline ^ wheel->current;
+    size_t level = (size_t)(63 - __builtin_clzll(difference)) / WHEEL_BITS;
+
+    if (level >= WHEEL_LEVELS)
+    {
+        timer->location = LOCATION_OVERFLOW;
+        return heap_insert_handle(wheel->overflow, &(timer->deadline), timer, &(timer->handle));
+    }
+
+    size_t slot = get_digit(timer->deadline, level);
+    timer->location = (level * WHEEL_SLOTS) + slot;
+    list_append(&(wheel->slots[level][slot]), &(timer->link));
+    wheel->used[level][slot / 64] |= (uint64_t)1 << (slot % 64);
+    return OK;
+}
+
+static void unlink_timer(timer_wheel_t * wheel, wheel_timer_t * timer)
+{
+    if (LOCATION_OVERFLOW == timer->location)
+    {
+        heap_remove(wheel->overflow, timer->handle, NULL);
+        timer->handle = NULL;
+        return;
+    }
+
+    list_remove(&(timer->link));
+
+    if (timer->location < LOCATION_DUE)
+    {
+        size_t level = timer->location / WHEEL_SLOTS;
+        size_t slot = timer->location % WHEEL_SLOTS;
+
+        if (list_empty(&(wheel->slots[level][slot])))
+        {
+            wheel->used[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+        }
+    }
+}
+
+static bool next_event(timer_wheel_t * wheel, uint64_t * tick)
+{
+    // Every occupied slot is ahead of the current digit of its level, so the
+    // lowest occupied slot of each level is that level's next event
+    bool found = false;
+    uint64_t next = 0;
+    for (size_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (size_t word = 0; word < WHEEL_WORDS; word++)
+        {
+            if (0 == wheel->used[level][word])
+            {
+                continue;
+            }
+
+            uint64_t slot = (word * 64) + (uint64_t)__builtin_ctzll(wheel->used[level][word]);
+            size_t upper_shift = WHEEL_BITS * (level + 1);
+            uint64_t event = ((wheel->current >> upper_shift) << upper_shift) | (slot << (WHEEL_BITS * level));
+
+            if (!found || (event < next))
+            {
+                next = event;
+                found = true;
+            }
+
+            break;
+        }
+    }
+
+    wheel_timer_t * timer = heap_peek(wheel->overflow);
+    if (timer != NULL)
+    {
+        // Overflow timers move into the wheel at the start of their 2^32 tick window
+        uint64_t event = (timer->deadline >> WHEEL_RANGE_BITS) << WHEEL_RANGE_BITS;
+
+        if (!found || (event < next))
+        {
+            next = event;
+            found = true;
+        }
+    }
+
+    *tick = next;
+    return found;
+}
+
+static void process_tick(timer_wheel_t * wheel, uint64_t tick)
+{
+    wheel->current = tick;
+
+    // Pull in overflow timers that now fall inside the wheel's range
+    wheel_timer_t * timer = heap_peek(wheel->overflow);
+    while ((timer != NULL) && ((timer->deadline >> WHEEL_RANGE_BITS) == (tick >> WHEEL_RANGE_BITS)))
+    {
+        heap_extract(wheel->overflow, NULL);
+        timer->handle = NULL;
+        // Can not fail, the timer lands in the wheel or the due list
+        place_timer(wheel, timer);
+        timer = heap_peek(wheel->overflow);
+    }
+
+    // Cascade from the top down so timers fall through every level that wraps at this tick
+    for (size_t level = WHEEL_LEVELS - 1; level > 0; level--)
+    {
+        uint64_t lower_mask = ((uint64_t)1 << (WHEEL_BITS * level)) - 1;
+
+        if (0 == (tick & lower_mask))
+        {
+            cascade(wheel, level, get_digit(tick, level));
+        }
+    }
+
+    // Everything in the level 0 slot expires at exactly this tick
+    size_t slot = get_digit(tick, 0);
+    link_t * head = &(wheel->slots[0][slot]);
+    for (link_t * link = head->next; link != head; link = link->next)
+    {
+        ((wheel_timer_t *)link)->location = LOCATION_DUE;
+    }
+
+    list_splice(&(wheel->due), head);
+    wheel->used[0][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+static void cascade(timer_wheel_t * wheel, size_t level, size_t slot)
+{
+    link_t pending;
+    list_init(&pending);
+    list_splice(&pending, &(wheel->slots[level][slot]));
+    wheel->used[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+
+    // Re-place every timer against the new current tick, each lands on a lower level
+    while (!list_empty(&pending))
+    {
+        wheel_timer_t * timer = (wheel_timer_t *)pending.next;
+        list_remove(&(timer->link));
+        place_timer(wheel, timer);
+    }
+}
+
+static size_t fire_expired(timer_wheel_t * wheel, visit_f expire, void * arg)
+{
+    // Only the timers due right now are fired, timers scheduled from the callback wait
+    list_splice(&(wheel->expiring), &(wheel->due));
+    for (link_t * link = wheel->expiring.next; link != &(wheel->expiring); link = link->next)
+    {
+        ((wheel_timer_t *)link)->location = LOCATION_EXPIRING;
+    }
+
+    size_t count = 0;
+    while (!list_empty(&(wheel->expiring)))
+    {
+        // The callback may cancel timers still in the expiring list
+        wheel_timer_t * timer = (wheel_timer_t *)wheel->expiring.next;
+        list_remove(&(timer->link));
+        void * data = timer->data;
+        release_timer(wheel, timer);
+        wheel->filled--;
+        count++;
+
+        if (expire != NULL)
+        {
+            expire(data, arg);
+        }
+    }
+
+    return count;
+}
+
+static wheel_timer_t * allocate_timer(timer_wheel_t * wheel)
+{
+    if (NULL == wheel->free_timers)
+    {
+        block_t * block = malloc(sizeof(*block));
+
+        if (NULL == block)
+        {
+            return NULL;
+        }
+
+        block->next = wheel->blocks;
+        wheel->blocks = block;
+
+        for (size_t i = 0; i < BLOCK_SZ; i++)
+        {
+            release_timer(wheel, &(block->timers[i]));
+        }
+    }
+
+    wheel_timer_t * timer = wheel->free_timers;
+    wheel->free_timers = (wheel_timer_t *)timer->link.next;
+    timer->handle = NULL;
+    return timer;
+}
+
+static void release_timer(timer_wheel_t * wheel, wheel_timer_t * timer)
+{
+    // Free timers are chained through their next link
+    timer->location = LOCATION_FREE;
+    timer->link.next = (link_t *)wheel->free_timers;
+    wheel->free_timers = timer;
+}
+
+static size_t get_digit(uint64_t tick, size_t level)
+{
+    return (size_t)((tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+}
+
+static int compare_deadlines(const void * arg1, const void * arg2)
+{
+    uint64_t deadline1 = *(const uint64_t *)arg1;
+    uint64_t deadline2 = *(const uint64_t *)arg2;
+    return (deadline1 > deadline2) - (deadline1 < deadline2);
+}
+// END OF SOURCE
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <dstruct_funcs.h>
+
+// Hierarchical timing wheel, time is counted in caller defined ticks.
+// A timer handle is only valid until the timer expires or is cancelled.
+typedef struct timer_wheel timer_wheel_t;
+typedef struct wheel_timer wheel_timer_t;
+
+timer_wheel_t * timer_wheel_create(uint64_t now);
+void timer_wheel_destroy(timer_wheel_t * wheel, destroy_f destroy_data);
+wheel_timer_t * timer_wheel_schedule(timer_wheel_t * wheel, uint64_t deadline, void * data);
+void * timer_wheel_cancel(timer_wheel_t * wheel, wheel_timer_t * timer);
+size_t timer_wheel_advance(timer_wheel_t * wheel, uint64_t now, visit_f expire, void * arg);
+size_t timer_wheel_get_size(timer_wheel_t * wheel);
+
+#endif
\ No newline at end of file